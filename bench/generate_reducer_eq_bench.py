@@ -25,6 +25,11 @@ parser.add_argument('-s', '--tile_size',
         required=False,
         default=100,
         dest='tile_size')
+parser.add_argument('-w', '--n_workers',
+        type=int,
+        required=False,
+        default=1,
+        dest='n_workers')
 parser.add_argument('-ro', '--reducer_outfile',
         type=str,
         required=False,
@@ -35,6 +40,7 @@ args = parser.parse_args()
 peer_ip_1 = args.peer_ip_1
 peer_ip_2 = args.peer_ip_2
 tile_size = args.tile_size
+n_workers = args.n_workers
 base_reducer_outfile = args.base_reducer_outfile
 
 party_nr = {"a":1, "b":2}
@@ -47,6 +53,7 @@ for party in ["a", "b"]:
 		"peer_ip_2": peer_ip_2,
 		"port": 50000,
 		"tile_size": tile_size,
+		"n_workers": n_workers,
                 "outfile": base_reducer_outfile+party+".csv"
 		}
     	}
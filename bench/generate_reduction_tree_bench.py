@@ -0,0 +1,141 @@
+# Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org>
+# Author: Roberta De Viti
+# SPDX-License-Identifier: MIT
+#
+# This script generates the benchmark files for the nodes of a reduction
+# tree (build/bin/reducer), for a given number of leaves and fan-in.
+# Leaf i receives n_tiles tiles from mapper i on mapreduce_port + i (set
+# the mapper's reducer_port accordingly). Each inner node receives one
+# list of output_size from each of its children. Nodes are numbered level
+# by level, from the leaves (0 .. n_leaves-1) to the root (last).
+
+import json
+import argparse
+
+parser = argparse.ArgumentParser(
+        description='Generate reduction tree benchmark files')
+
+parser.add_argument('-p', '--party',
+        type=str,
+        required=False,
+        default="a",
+        dest='party')
+parser.add_argument('-i', '--peer_ip',
+        type=str,
+        required=False,
+        default="10.3.32.3",
+        dest='peer_ip')
+parser.add_argument('-l', '--n_leaves',
+        type=int,
+        required=False,
+        default=8,
+        dest='n_leaves')
+parser.add_argument('-f', '--fan_in',
+        type=int,
+        required=False,
+        default=2,
+        dest='fan_in')
+parser.add_argument('-s', '--tile_size',
+        type=int,
+        required=False,
+        default=100,
+        dest='tile_size')
+parser.add_argument('-t', '--n_tiles',
+        type=int,
+        required=False,
+        default=2,
+        dest='n_tiles')
+parser.add_argument('-d', '--output_size',
+        type=int,
+        required=False,
+        default=500,
+        dest='output_size')
+parser.add_argument('-b', '--batch',
+        action='store_true',
+        help='reduce all the lists at the end instead of streaming them '
+             'through a bounded window',
+        dest='batch')
+parser.add_argument('-w', '--n_workers',
+        type=int,
+        required=False,
+        default=1,
+        dest='n_workers')
+parser.add_argument('-n', '--n_reps',
+        type=int,
+        required=False,
+        default=1,
+        dest='n_reps')
+parser.add_argument('-o', '--outfile',
+        type=str,
+        required=False,
+        default="./reduction_tree_",
+        dest='base_outfile')
+
+args = parser.parse_args()
+party_nr = {"a":1, "b":2}
+localhost = "127.0.0.1"
+base_port = 51000       # 2PC port of node i: base_port + i
+mapreduce_port = 60000  # leaf i listens to its mapper on mapreduce_port + i
+tree_port = 61000       # node i listens to its children on tree_port + ...
+pool_port = 40000       # node i's session pool: pool_port + i * n_workers + w,
+pool_end_port = 50000   # up to pool_end_port (see include/parallel_sort.hpp)
+
+if args.fan_in < 2:
+    parser.error("fan_in must be at least 2")
+if args.n_workers < 1:
+    parser.error("n_workers must be at least 1")
+
+# build the tree level by level: children[i] lists the children of node i
+children = {}
+level = list(range(args.n_leaves))
+next_id = args.n_leaves
+while len(level) > 1:
+    parents = []
+    for k in range(0, len(level), args.fan_in):
+        children[next_id] = level[k:k + args.fan_in]
+        parents.append(next_id)
+        next_id += 1
+    level = parents
+root = level[0]
+if pool_port + next_id * args.n_workers > pool_end_port:
+    parser.error("the session pools of " + str(next_id) + " nodes with " +
+                 str(args.n_workers) + " workers do not fit below port " +
+                 str(pool_end_port))
+parent = {c: p for p, cs in children.items() for c in cs}
+
+for node in range(next_id):
+    if node < args.n_leaves:
+        upstream = [{"port": mapreduce_port + node,
+                     "n_lists": args.n_tiles,
+                     "list_size": args.tile_size,
+                     "sorted": False}]
+    else:
+        upstream = [{"port": tree_port + args.fan_in * node + k,
+                     "n_lists": 1,
+                     "list_size": args.output_size,
+                     "sorted": True} for k in range(len(children[node]))]
+
+    options = {
+        "party": party_nr[args.party],
+        "peer_ip": args.peer_ip,
+        "port": base_port + node,
+        "output_size": args.output_size,
+        "upstream": upstream,
+        "streaming": not args.batch,
+        "n_workers": args.n_workers,
+        "pool_session": node,
+        "n_reps": args.n_reps,
+        "outfile": args.base_outfile + args.party + "_" + str(node) + ".csv",
+    }
+    if node != root:
+        p = parent[node]
+        options["downstream_ip"] = localhost
+        options["downstream_port"] = (tree_port + args.fan_in * p +
+                                      children[p].index(node))
+
+    val = {"description": "Reduction tree node benchfile", "options": options}
+    with open('reduction_tree_' + args.party + '_' + str(node) + '.json',
+              'w') as out:
+        out.write(json.dumps(val, indent=4))
+
+print("Generated " + str(next_id) + " nodes, root: " + str(root))
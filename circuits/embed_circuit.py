@@ -0,0 +1,54 @@
+# Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org>
+# Author: Roberta De Viti
+# SPDX-License-Identifier: MIT
+#
+# This script converts a circuit in Bristol format into a C++ source file
+# with its gates as a constexpr array, in the layout of emp::BristolFormat
+# (4 ints per gate: input 1, input 2, output, type), so that the circuit is
+# linked into the binaries instead of parsed at runtime (see
+# include/embedded_circuits.hpp). CMake runs it at build time.
+
+import argparse
+
+parser = argparse.ArgumentParser(
+        description='Embed a Bristol format circuit into a C++ source file')
+parser.add_argument('infile', type=str, help='circuit in Bristol format')
+parser.add_argument('name', type=str, help='C++ name of the circuit')
+parser.add_argument('outfile', type=str, help='C++ source file to write')
+args = parser.parse_args()
+
+with open(args.infile) as f:
+    tokens = f.read().split()
+
+num_gate, num_wire, n1, n2, n3 = (int(t) for t in tokens[:5])
+types = {"AND": "A", "XOR": "X", "INV": "N"}
+gates = []
+pos = 5
+for g in range(num_gate):
+    n_in, n_out = int(tokens[pos]), int(tokens[pos + 1])
+    wires = tokens[pos + 2:pos + 2 + n_in + n_out]
+    gate_type = tokens[pos + 2 + n_in + n_out]
+    pos += 3 + n_in + n_out
+    if n_out != 1 or gate_type not in types or n_in != (1 if gate_type == "INV" else 2):
+        raise SystemExit("Error: unsupported gate " + str(g) + " in " +
+                         args.infile)
+    in_2 = wires[1] if n_in == 2 else "0"
+    gates.append(wires[0] + "," + in_2 + "," + wires[n_in] + "," +
+                 types[gate_type])
+
+with open(args.outfile, 'w') as out:
+    out.write("// Generated by circuits/embed_circuit.py from " + args.infile +
+              ", do not edit.\n\n")
+    out.write('#include "include/embedded_circuits.hpp"\n\n')
+    out.write("namespace circuits {\n")
+    out.write("namespace {\n")
+    out.write("constexpr int A = AND_GATE, X = XOR_GATE, N = NOT_GATE;\n")
+    out.write("constexpr int gates[] = {\n")
+    for k in range(0, len(gates), 8):
+        out.write(",".join(gates[k:k + 8]) + ",\n")
+    out.write("};\n")
+    out.write("}  // namespace\n\n")
+    out.write("extern const Embedded " + args.name + " = {" +
+              ", ".join(str(v) for v in (num_gate, num_wire, n1, n2, n3)) +
+              ", gates};\n")
+    out.write("}  // namespace circuits\n")
@@ -72,6 +72,12 @@ IF(THREADING)
 	message("Multi Threading: on")
 ENDIF(THREADING)
 
+OPTION(DEBUG_SYNC "sync() barriers between the path query 2PC steps, for debugging" OFF)
+IF(DEBUG_SYNC)
+	ADD_DEFINITIONS(-DDEBUG_SYNC)
+	message("Debug sync barriers: on")
+ENDIF(DEBUG_SYNC)
+
 
 set(CMAKE_RUNTIME_OUTPUT_DIRECTORY ${CMAKE_BINARY_DIR}/bin )
 set(CMAKE_PREFIX_PATH ${CMAKE_PREFIX_PATH} ${CMAKE_SOURCE_DIR}/cmake)
@@ -1,151 +1,181 @@
-// Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org> 
-// Author: Roberta De Viti 
+// Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org>
+// Author: Roberta De Viti
 // SPDX-License-Identifier: MIT
 
 #pragma once
-#include <counter.h>
+#include <emp-sh2pc/emp-sh2pc.h>
 #include <math.h>
 
+#include <iostream>
+#include <vector>
+
+// An oblivious Bloom filter over in-circuit values.
+// The filter size is a power of two, 2^hash_bits, so hash k of a value is just
+// its bits [k * hash_bits, (k + 1) * hash_bits): no modulo or shift circuits.
+// Each hash is decoded into a one-hot vector over the filter with a
+// demultiplexer tree (filter_size - 1 ANDs, hash_bits deep), and the filter
+// is read or updated with one AND per position: O(filter_size) ANDs per hash,
+// instead of an element_size-bit comparison at every position.
 template <size_t element_size, int n_hashes>
 class BloomFilter {
+    static_assert(n_hashes > 0, "BloomFilter: needs at least one hash");
+
    private:
     // false positive rate
     const float fpp = 0.01;
     const float mn_ratio = -n_hashes / log(1 - exp(log(fpp) / n_hashes));
+    size_t hash_bits_;
     size_t filter_size_;
-    emp::Integer n_hashbits_;
-    emp::Integer bit_zero_;
-    emp::Integer bit_one_;
-    emp::Integer mask_zero_;
-    emp::Integer mask_one_;
-    emp::Integer mask_filter_size_;
-    std::vector<emp::Integer> filter_;
+    std::vector<emp::Bit> filter_;
+
+    // the smallest power of two holding mn_ratio * n_elements bits, as a
+    // number of hash bits
+    static size_t hash_bits_for(float const bits) {
+        size_t hash_bits = 0;
+        while ((size_t(1) << hash_bits) < bits) {
+            hash_bits++;
+        }
+        return hash_bits;
+    }
+
+    // one-hot vector of hash k of value: position p is 1 iff the hash is p.
+    // with enable, all positions are 0 unless enable is set (one more AND).
+    std::vector<emp::Bit> decode(emp::Integer const& value, size_t const k,
+                                 emp::Bit const* enable = nullptr) const {
+        // a hash past the end of the value would read constant bits, so that
+        // all values would collide on it
+        if ((k + 1) * this->hash_bits_ > value.bits.size()) {
+            std::cerr << "BloomFilter: " << n_hashes << " hashes of "
+                      << this->hash_bits_ << " bits do not fit in "
+                      << value.bits.size() << "-bit values" << std::endl;
+            exit(1);
+        }
+        std::vector<emp::Bit> one_hot(1, emp::Bit(true, emp::PUBLIC));
+        if (enable != nullptr) {
+            one_hot[0] = *enable;
+        }
+        one_hot.reserve(this->filter_size_);
+        // each level splits every position on the next hash bit, lowest
+        // first: one AND per new position (the other half is an XOR)
+        for (size_t b = 0; b < this->hash_bits_; b++) {
+            emp::Bit const bit = value.bits[k * this->hash_bits_ + b];
+            size_t const half = one_hot.size();
+            one_hot.resize(2 * half);
+            for (size_t j = 0; j < half; j++) {
+                // the root is a public 1 without enable: no AND needed
+                one_hot[half + j] = (b == 0 && enable == nullptr)
+                                        ? bit
+                                        : (one_hot[j] & bit);
+                one_hot[j] = one_hot[j] ^ one_hot[half + j];
+            }
+        }
+        return one_hot;
+    }
+
+    // whether the filter is set at the position of a one-hot vector: at most
+    // one term is 1, so the OR of the terms is their XOR
+    emp::Bit lookup(std::vector<emp::Bit> const& one_hot) const {
+        emp::Bit hit(false, emp::PUBLIC);
+        for (size_t j = 0; j < this->filter_size_; j++) {
+            hit = hit ^ (one_hot[j] & this->filter_[j]);
+        }
+        return hit;
+    }
+
+    static void merge(std::vector<emp::Bit>& positions,
+                      std::vector<emp::Bit> const& one_hot) {
+        for (size_t j = 0; j < positions.size(); j++) {
+            positions[j] = positions[j] | one_hot[j];
+        }
+    }
+
+    // the positions of all hashes of value (all 0 unless enable, if given)
+    std::vector<emp::Bit> positions(emp::Integer const& value,
+                                    emp::Bit const* enable = nullptr) const {
+        std::vector<emp::Bit> positions = this->decode(value, 0, enable);
+        for (size_t k = 1; k < size_t(n_hashes); k++) {
+            merge(positions, this->decode(value, k, enable));
+        }
+        return positions;
+    }
+
+    emp::Bit contains_bit(emp::Integer const& value) const {
+        emp::Bit contained = this->lookup(this->decode(value, 0));
+        for (size_t k = 1; k < size_t(n_hashes); k++) {
+            contained = contained & this->lookup(this->decode(value, k));
+        }
+        return contained;
+    }
+
+    static emp::Integer to_integer(emp::Bit const& bit) {
+        emp::Integer result(1, 0, emp::PUBLIC);
+        result.bits[0] = bit;
+        return result;
+    }
 
    public:
     BloomFilter(size_t const n_elements)
-        : filter_size_(ceil(this->mn_ratio * n_elements)),
-          // ceiling(log2(filter_size))
-          n_hashbits_(emp::Integer(element_size, std::ceil(log2(filter_size_)),
-                                   emp::PUBLIC)),
-          bit_zero_(emp::Integer(1, 0, emp::PUBLIC)),
-          bit_one_(emp::Integer(1, 1, emp::PUBLIC)),
-          mask_zero_(emp::Integer(element_size, 0, emp::PUBLIC)),
-          mask_one_(emp::Integer(element_size, 1, emp::PUBLIC)),
-          mask_filter_size_(
-              emp::Integer(element_size, this->filter_size_, emp::PUBLIC)),
-          filter_(filter_size_, emp::Integer(1, 0, emp::PUBLIC)) {}
+        : hash_bits_(hash_bits_for(ceil(this->mn_ratio * n_elements))),
+          filter_size_(size_t(1) << hash_bits_),
+          filter_(filter_size_, emp::Bit(false, emp::PUBLIC)) {}
+
+    size_t size() const { return this->filter_size_; }
 
     void initialize() {
         for (size_t i = 0; i < this->filter_size_; i++) {
-            this->filter_[i] = this->bit_zero_;
+            this->filter_[i] = emp::Bit(false, emp::PUBLIC);
         }
     }
 
     void insert(emp::Integer const value) {
-        emp::Integer hash_pos = this->mask_zero_;
-        emp::Integer shift_pos = this->mask_zero_;
-        std::vector<emp::Integer> hashes;
-        // emp::Integer filter_at_hash_pos = this->bit_one_;
-
-        // for each hash function
-        for (size_t i = 0; i < n_hashes; i++) {
-            // dbg(shift_pos.reveal<int>());
-            // compute hash value hash_pos (n_hashbits bits from the value)
-            hash_pos =
-                (((this->mask_one_ << this->n_hashbits_) - this->mask_one_) &
-                 (value >> shift_pos)) %
-                this->mask_filter_size_;
-            hashes.emplace_back(hash_pos);
-            // shift of n_hashbits
-            shift_pos = shift_pos + this->n_hashbits_;
-        }
+        merge(this->filter_, this->positions(value));
+    }
 
-        emp::Integer position = this->mask_zero_;
-        for (size_t j = 0; j < this->filter_size_; j++) {
-            // if the current position is hash_pos, set it to '1'
-            emp::Bit cond;
-            for (size_t k = 0; k < hashes.size(); k++) {
-                cond = cond | (position == hashes[k]);
-            }
-            this->filter_[j] = this->filter_[j] |
-                               emp::If(cond, this->bit_one_, this->bit_zero_);
-            position = position + this->mask_one_;
+    // insert value only if enable is set
+    void insert(emp::Integer const value, emp::Bit const enable) {
+        merge(this->filter_, this->positions(value, &enable));
+    }
+
+    // insert count values (those with enable[i] set, if given): their one-hot
+    // vectors are ORed together before one update of the filter
+    void insert_batch(emp::Integer const values[], size_t const count,
+                      emp::Bit const enable[] = nullptr) {
+        if (count == 0) {
+            return;
         }
+        std::vector<emp::Bit> batch = this->positions(
+            values[0], (enable == nullptr) ? nullptr : &enable[0]);
+        for (size_t i = 1; i < count; i++) {
+            merge(batch, this->positions(values[i], (enable == nullptr)
+                                                        ? nullptr
+                                                        : &enable[i]));
+        }
+        merge(this->filter_, batch);
     }
 
+    // the value is in the filter only if all n_hashes bits are set to '1'
     emp::Integer contains(emp::Integer const value) const {
-        emp::Integer hash_pos = this->mask_zero_;
-        emp::Integer shift_pos = this->mask_zero_;
-        // keep count of the numbers of bits set for the value
-        emp::Integer n_hashes_count(3, n_hashes, emp::PUBLIC);
-        Counter<3> counter = Counter<3>();
-
-        // for each hash function
-        for (size_t i = 0; i < n_hashes; i++) {
-            // dbg(shift_pos.reveal<int>());
-            // compute hash value hash_pos (n_hashbits bits from the value)
-            hash_pos =
-                (((this->mask_one_ << this->n_hashbits_) - this->mask_one_) &
-                 (value >> shift_pos)) %
-                this->mask_filter_size_;
-            // dbg(i, hash_pos.reveal<int>());
-            // scan the whole filter to hide the real position
-            emp::Integer position = this->mask_zero_;
-            for (size_t j = 0; j < this->filter_size_; j++) {
-                // add filter's value at hash_pos to the counter
-                counter.add(emp::If(
-                    ((position == hash_pos) & (filter_[j] == this->bit_one_)),
-                    counter.one_, counter.zero_));
-                position = position + this->mask_one_;
-            }
-            // shift of n_hashbits
-            shift_pos = shift_pos + this->n_hashbits_;
-        }
-        // the value is in the filter only if all bits ( = n_hashes) are set to
-        // '1'
-        emp::Integer already_in_bf =
-            emp::If(counter.get_count() == n_hashes_count, this->bit_one_,
-                    this->bit_zero_);
-        return already_in_bf;
+        return to_integer(this->contains_bit(value));
     }
 
     emp::Integer contains_and_insert(emp::Integer const value) {
-        emp::Integer hash_pos = this->mask_zero_;
-        emp::Integer shift_pos = this->mask_zero_;
-        // keep count of the numbers of bits set for the value
-        emp::Integer n_hashes_count(3, n_hashes, emp::PUBLIC);
-        Counter<3> counter = Counter<3>();
-
-        // for each hash function
-        for (size_t i = 0; i < n_hashes; i++) {
-            // dbg(shift_pos.reveal<int>());
-            // compute hash value hash_pos (n_hashbits bits from the value)
-            hash_pos =
-                (((this->mask_one_ << this->n_hashbits_) - this->mask_one_) &
-                 (value >> shift_pos)) %
-                this->mask_filter_size_;
-            // scan the whole filter to hide the real position
-            emp::Integer position = this->mask_zero_;
-            for (size_t j = 0; j < this->filter_size_; j++) {
-                // add filter's value at hash_pos to the counter, adds '0' if
-                // not at hash_pos
-                counter.add(emp::If(
-                    ((position == hash_pos) & (filter_[j] == this->bit_one_)),
-                    counter.one_, counter.zero_));
-                // if the current position is hash_pos, set it to '1'
-                this->filter_[j] =
-                    this->filter_[j] | emp::If(position == hash_pos,
-                                               this->bit_one_, this->bit_zero_);
-                position = position + this->mask_one_;
-            }
-            // shift of n_hashbits
-            shift_pos = shift_pos + this->n_hashbits_;
+        std::vector<emp::Bit> positions = this->decode(value, 0);
+        emp::Bit already_in_bf = this->lookup(positions);
+        for (size_t k = 1; k < size_t(n_hashes); k++) {
+            std::vector<emp::Bit> const one_hot = this->decode(value, k);
+            already_in_bf = already_in_bf & this->lookup(one_hot);
+            merge(positions, one_hot);
         }
-        // the value is in the filter only if all bits ( = n_hashes) are set to
-        // '1'
-        emp::Integer already_in_bf =
-            emp::If(counter.get_count() == n_hashes_count, this->bit_one_,
-                    this->bit_zero_);
-        return already_in_bf;
+        merge(this->filter_, positions);
+        return to_integer(already_in_bf);
+    }
+
+    // as above, but only inserts if enable is set; the result is still
+    // whether value was in the filter before
+    emp::Integer contains_and_insert(emp::Integer const value,
+                                     emp::Bit const enable) {
+        emp::Bit already_in_bf = this->contains_bit(value);
+        this->insert(value, enable);
+        return to_integer(already_in_bf);
     }
 };
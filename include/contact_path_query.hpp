@@ -11,6 +11,7 @@
 #include <include/encounter.hpp>
 #include <include/bloomfilter.h>
 #include <include/secrets.hpp>
+#include <include/sort_join.hpp>
 #include <include/store_path_encounter.hpp>
 #include <unordered_map>
 #include <immintrin.h>
@@ -22,8 +23,48 @@ uint64_t time_now_millis() {
     return (uint64_t) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
+// the SORT_JOIN count of contact(): the number of distinct groups (shuffle, walked device) with a valid encounter whose
+// encountered device is in filter_ids. The ids and the encounters are sorted once by (id, ids first), and one pass
+// carries whether the current id is in the set.
+emp::Integer contact_sort_join(const emp::Integer filter_ids[],
+                               const size_t filter_count,
+                               const std::vector<emp::Integer> & encountered,
+                               const std::vector<emp::Integer> & groups,
+                               const std::vector<emp::Bit> & valid) {
+  const size_t id_bits = 8 * sizeof(encounter::DeviceID);
+  const size_t size = filter_count + encountered.size();
+  const size_t group_bits = groups.empty() ? 1 : groups[0].size();
+  const emp::Integer no_group(group_bits, 0, emp::PUBLIC);
+  const emp::Integer id_tag = bit_integer(emp::Bit(false, emp::PUBLIC));
+  const emp::Integer tuple_tag = bit_integer(emp::Bit(true, emp::PUBLIC));
+  std::vector<emp::Integer> keys(size);
+  std::vector<emp::Integer> payloads(size);
+  for (size_t f = 0; f < filter_count; ++f) {
+    keys[f] = concat({&id_tag, &(filter_ids[f])});
+    payloads[f] = concat({&no_group, &id_tag});
+  }
+  for (size_t t = 0; t < encountered.size(); ++t) {
+    const emp::Integer is_valid = bit_integer(valid[t]);
+    keys[filter_count + t] = concat({&tuple_tag, &(encountered[t])});
+    payloads[filter_count + t] = concat({&(groups[t]), &is_valid});
+  }
+  emp::sort(keys.data(), (int) size, payloads.data(), true);
+
+  const std::vector<emp::Bit> heads = id_heads(keys, 1, id_bits);
+  std::vector<emp::Integer> hit_groups(size);
+  std::vector<emp::Bit> hits(size);
+  emp::Bit member;
+  for (size_t r = 0; r < size; ++r) {
+    const emp::Bit is_tuple = keys[r].bits[0];
+    member = (r == 0) ? !is_tuple : ((!is_tuple) | ((!heads[r]) & member));
+    hits[r] = is_tuple & payloads[r].bits[group_bits] & member;
+    hit_groups[r] = sub_integer(payloads[r], 0, group_bits);
+  }
+  return count_groups_with_hits(hit_groups, hits);
+}
+
 // walk through the histories of the source or sink devices (whichever is a smaller set), to count how many of them had contact with devices from the other set.
-// (we check that using a BLOOM filter)
+// (we check that using a BLOOM filter, or with a sort join: see WalkStrategy)
 template <size_t element_size, int n_hashes>
 bool contact(ShuffleStore * shuffle_store,
              dualex::Revealer * revealer,         
@@ -44,7 +85,8 @@ bool contact(ShuffleStore * shuffle_store,
              const secrets::Side side,
              const secrets::Side storing_side = secrets::RIGHT,
              const size_t encounters_per_device_per_shuffle = 300,
-             const bool debug_printouts = false
+             const bool debug_printouts = false,
+             const WalkStrategy strategy = WalkStrategy::BLOOM_FILTER
             ) {
   const emp::Integer * walk_ids = (source_count < sink_count) ? source_device_ids : sink_device_ids;
   const emp::Integer * walk_times = (source_count < sink_count) ? source_timestamps : sink_timestamps;
@@ -54,40 +96,51 @@ bool contact(ShuffleStore * shuffle_store,
 
   uint64_t init_time;
   uint64_t walk_time;
-  uint64_t fetch_times[shuffle_count * walk_count * encounters_per_device_per_shuffle];
-  uint64_t check_times[shuffle_count * walk_count * encounters_per_device_per_shuffle];
-  uint64_t walk_timings[shuffle_count * walk_count * encounters_per_device_per_shuffle];
+  // one fetch batch (of walk_count encounters) per shuffle per step of the walk
+  uint64_t fetch_times[shuffle_count * encounters_per_device_per_shuffle];
+  uint64_t check_times[shuffle_count * encounters_per_device_per_shuffle];
+  uint64_t walk_timings[shuffle_count * encounters_per_device_per_shuffle];
   uint64_t total_time = time_now_millis();
   init_time = time_now_millis();
-  BloomFilter<element_size, n_hashes> filter(filter_count);
+  // only the BLOOM_FILTER walk uses the filter
+  std::unique_ptr<BloomFilter<element_size, n_hashes>> filter;
   emp::Integer walk_previous[walk_count];
-  emp::Integer encountered;
-  emp::Integer previous;
-  emp::Integer duration;
-  emp::Integer confirmed;
+  std::vector<emp::Integer> fetched_encountered(walk_count);
+  std::vector<emp::Integer> fetched_previous(walk_count);
+  std::vector<emp::Integer> fetched_duration(walk_count);
+  std::vector<emp::Integer> fetched_confirmed(walk_count);
+  std::vector<emp::Integer> dummy_nonces(walk_count);
   emp::Integer dummy_nonce;
   emp::Integer one_256_bits;
   emp::Integer device;
   emp::Integer start_time_integer;
   const emp::Integer one_32_bits = emp::Integer(32, (int32_t) 1, emp::PUBLIC);
-  emp::Bit fetch_dummy;
-  emp::Bit this_device_had_contact;
-  size_t index = 0;
+  std::unique_ptr<emp::Bit[]> fetch_dummies(new emp::Bit[walk_count]);
+  std::unique_ptr<emp::Bit[]> this_device_had_contact(new emp::Bit[walk_count]);
+  size_t batch = 0;
   encounter::Timestamp revealstamp;
+  // SORT_JOIN: the fetched encounters, each tagged with its (shuffle, walked device) group
+  const bool sort_join = (strategy == WalkStrategy::SORT_JOIN);
+  const size_t group_bits = index_bits(shuffle_count * walk_count);
+  std::vector<emp::Integer> join_encountered;
+  std::vector<emp::Integer> join_groups;
+  std::vector<emp::Bit> join_valid;
+  uint64_t join_time = 0;
 
   (*output_count) = emp::Integer(32, (int32_t) 0, emp::PUBLIC);
   device.bits.resize(256);
   one_256_bits.bits.resize(256);
   one_256_bits.bits[0] = emp::Bit(true, emp::PUBLIC);
-  filter.initialize();
   for (size_t i = 1; i < 256; ++i) {
     one_256_bits.bits[i] = emp::Bit(false, emp::PUBLIC);
   }
   for (size_t i = 0; i < walk_count; ++i) {
     walk_previous[i] = walk_times[i];
   }
-  for (size_t i = 0; i < filter_count; ++i) {
-    filter.insert(filter_ids[i]);
+  if (!sort_join) {
+    filter = std::make_unique<BloomFilter<element_size, n_hashes>>(filter_count);
+    filter->initialize();
+    filter->insert_batch(filter_ids, filter_count);
   }
   init_time = time_now_millis() - init_time;
   std::cout << "init_time = " << init_time << std::endl;
@@ -99,89 +152,111 @@ bool contact(ShuffleStore * shuffle_store,
     dummy_nonce = emp::Integer(256, &(dummy_start_nonces[s]));
     start_time_integer = emp::Integer(8 * (sizeof(encounter::Timestamp)), (int64_t) shuffle_start_times[s], emp::PUBLIC);
     for (size_t i = 0; i < walk_count; ++i) {
-      this_device_had_contact = emp::Bit(false, emp::PUBLIC);
-      for (size_t j = 0; j < encounters_per_device_per_shuffle; ++j) {
-        walk_timings[index] = time_now_millis();
-        fetch_times[index] = time_now_millis();
+      this_device_had_contact[i] = emp::Bit(false, emp::PUBLIC);
+    }
+    // the j-th fetches of all the walked devices are independent: fetch them as one batch
+    for (size_t j = 0; j < encounters_per_device_per_shuffle; ++j) {
+      walk_timings[batch] = time_now_millis();
+      fetch_times[batch] = time_now_millis();
+      for (size_t i = 0; i < walk_count; ++i) {
         // if this user's previous entry is too early for this shuffle, fetch a dummy.
-        fetch_dummy = (start_time_integer.geq(walk_previous[i]));
+        fetch_dummies[i] = (start_time_integer.geq(walk_previous[i]));
+        // each dummy fetched gets the next dummy_nonce
+        dummy_nonces[i] = dummy_nonce;
+        dummy_nonce = emp::If(fetch_dummies[i], dummy_nonce + one_256_bits, dummy_nonce);
         if (debug_printouts) {
           std::cout << "fetch s = " << s << "\ti = " << i << "\tj = " << j << std::endl << std::flush;
           start_time_integer.reveal(&revealstamp, emp::PUBLIC);
           std::cout << "shuffle_start_time " << *((int32_t *) &revealstamp) << std::endl << std::flush;
           walk_previous[i].reveal(&revealstamp, emp::PUBLIC);
           std::cout << "previous " << revealstamp << std::endl << std::flush;
-          std::cout << "it's a dummy: " << fetch_dummy.reveal(emp::PUBLIC) << std::endl << std::flush;
-        }
-        if (!fetch_and_decrypt_encounter(shuffle_store,
-                                         revealer,
-                                         shuffles[s],
-                                         &(walk_ids[i]),
-                                         &(walk_previous[i]),
-                                         &encountered,
-                                         &previous,
-                                         &duration,
-                                         &confirmed,
-                                         side,
-                                         storing_side,
-                                         &dummy_nonce,
-                                         &fetch_dummy)) {
-          std::cerr << "failed to fetch encounter from shuffle_store.\n" << std::flush;
-          return false;
+          std::cout << "it's a dummy: " << fetch_dummies[i].reveal(emp::PUBLIC) << std::endl << std::flush;
         }
-        fetch_times[index] = time_now_millis() - fetch_times[index];
-        std::cout << "fetch_times[" << index << "] = " << fetch_times[index]<< std::endl;
-        check_times[index] = time_now_millis();
-        if (debug_printouts) {
-          std::cout << "fetch s = " << s << "\ti = " << i << "\tj = " << j << " complete.\n" << std::flush;
+      }
+      if (!fetch_and_decrypt_encounters(shuffle_store,
+                                        revealer,
+                                        shuffles[s],
+                                        walk_ids,
+                                        walk_previous,
+                                        walk_count,
+                                        fetched_encountered.data(),
+                                        fetched_previous.data(),
+                                        fetched_duration.data(),
+                                        fetched_confirmed.data(),
+                                        side,
+                                        storing_side,
+                                        dummy_nonces.data(),
+                                        fetch_dummies.get())) {
+        std::cerr << "failed to fetch encounters from shuffle_store.\n" << std::flush;
+        return false;
+      }
+      fetch_times[batch] = time_now_millis() - fetch_times[batch];
+      std::cout << "fetch_times[" << batch << "] = " << fetch_times[batch]<< std::endl;
+      check_times[batch] = time_now_millis();
+      if (debug_printouts) {
+        std::cout << "fetch s = " << s << "\tj = " << j << " complete.\n" << std::flush;
+      }
+      for (size_t i = 0; i < walk_count; ++i) {
+        // if we didn't fetch a dummy, and the encounter has sufficient duration and confirmed, set this user's bit to 1.
+        const emp::Bit valid = (!fetch_dummies[i]) & fetched_confirmed[i][0] &
+          (*start_time < walk_previous[i]) & (walk_previous[i] < *end_time);
+        if (sort_join) {
+          join_encountered.push_back(fetched_encountered[i]);
+          join_groups.emplace_back(group_bits, (int64_t) (s * walk_count + i), emp::PUBLIC);
+          join_valid.push_back(valid);
+        } else {
+          this_device_had_contact[i] = this_device_had_contact[i] | (valid & filter->contains(fetched_encountered[i])[0]);
         }
-        // if we didn't fetch a dummy, and the encounter has sufficient duration and confirmed, set this user's bit to 1. 
-        this_device_had_contact = this_device_had_contact | ((!fetch_dummy) & confirmed[0] &
-          (*start_time < walk_previous[i]) & (walk_previous[i] < *end_time) & filter.contains(encountered)[0]);
-        
+
         // update this user's previous entry if we didn't fetch a dummy.
-        walk_previous[i] = emp::If(fetch_dummy, walk_previous[i], previous);
-        
-        // if we fetched a dummy, then increment dummy_nonce
-        dummy_nonce = emp::If(fetch_dummy, dummy_nonce + one_256_bits, dummy_nonce);
-        check_times[index] = time_now_millis() - check_times[index];
-        std::cout << "check_times[" << index << "] = " << check_times[index]<< std::endl;
-        walk_timings[index] = time_now_millis() - walk_timings[index];
-        std::cout << "walk_timings[" << index << "] = " << walk_timings[index]<< std::endl;
-        ++index;
+        walk_previous[i] = emp::If(fetch_dummies[i], walk_previous[i], fetched_previous[i]);
       }
-      (*output_count) = emp::If(this_device_had_contact, (*output_count) + one_32_bits, (*output_count));
+      check_times[batch] = time_now_millis() - check_times[batch];
+      std::cout << "check_times[" << batch << "] = " << check_times[batch]<< std::endl;
+      walk_timings[batch] = time_now_millis() - walk_timings[batch];
+      std::cout << "walk_timings[" << batch << "] = " << walk_timings[batch]<< std::endl;
+      ++batch;
+    }
+    for (size_t i = 0; i < walk_count && !sort_join; ++i) {
+      (*output_count) = emp::If(this_device_had_contact[i], (*output_count) + one_32_bits, (*output_count));
     }
   }
+  if (sort_join) {
+    join_time = time_now_millis();
+    (*output_count) = contact_sort_join(filter_ids, filter_count, join_encountered, join_groups, join_valid);
+    join_time = time_now_millis() - join_time;
+    std::cout << "join_time = " << join_time << std::endl;
+  }
   total_time = time_now_millis() - total_time;
   walk_time = time_now_millis() - walk_time;
   
   uint64_t total_fetch_time = 0;
   uint64_t total_check_time = 0;
 
-  std::cout << "fetch_times[" << index << "] = ";
-  for (size_t i = 0; i < index; ++i) {
+  std::cout << "fetch_times[" << batch << "] = ";
+  for (size_t i = 0; i < batch; ++i) {
     std::cout << fetch_times[i] << ", ";
     total_fetch_time += fetch_times[i];
   }
   std::cout << std::endl << std::endl;
-  std::cout << "check_times[" << index << "] = ";
-  for (size_t i = 0; i < index; ++i) {
+  std::cout << "check_times[" << batch << "] = ";
+  for (size_t i = 0; i < batch; ++i) {
     std::cout << check_times[i] << ", ";
     total_check_time += check_times[i];
   }
   std::cout << std::endl << std::endl;
-  std::cout << "walk_timings[" << index << "] = ";
-  for (size_t i = 0; i < index; ++i) {
+  std::cout << "walk_timings[" << batch << "] = ";
+  for (size_t i = 0; i < batch; ++i) {
     std::cout << walk_timings[i] << ", ";
   }
   std::cout << std::endl << std::endl;
   std::cout << "init_time = " << init_time << std::endl;
-  std::cout << "walk_length = " << index << std::endl;
+  // the means are per fetch batch (walk_count encounters each)
+  std::cout << "fetch_batches = " << batch << std::endl;
   std::cout << "total_fetch_time = " << total_fetch_time << std::endl;
-  std::cout << "mean_fetch_time = " << (total_fetch_time / index) << std::endl;
+  std::cout << "mean_fetch_time = " << (batch ? total_fetch_time / batch : 0) << std::endl;
   std::cout << "total_check_time = " << total_check_time << std::endl;
-  std::cout << "mean_check_time = " << (total_check_time / index) << std::endl;
+  std::cout << "mean_check_time = " << (batch ? total_check_time / batch : 0) << std::endl;
   std::cout << "walk_time = " << walk_time << std::endl;
   std::cout << "total_time = " << total_time << std::endl;
 
@@ -8,6 +8,11 @@
  **********************************************/
 
 #pragma once
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include <emp-tool/emp-tool.h>
 #include "emp-ag2pc/emp-ag2pc.h"
 
@@ -84,16 +89,23 @@ void run_circuit_malicious(int party, string input, emp::NetIO* io, string filen
     delete[] out;
 }
 
-// function used in reducer_eq
-bool maliciously_secure_equality_check(int party, bool* input, emp::NetIO* io, std::string filename) {
-    
-    // load circuit file
+// load a circuit file from circuits/
+std::shared_ptr<emp::BristolFormat> load_circuit(std::string filename) {
     std::fstream infile("circuits/" + filename);
     if(!infile.is_open()) {
         std::cerr << "Error. Circuit file " << filename << " not found.\n";
         std::exit(-1);
     }
-    emp::BristolFormat cf(("circuits/" + filename).c_str());
+    return std::make_shared<emp::BristolFormat>(("circuits/" + filename).c_str());
+}
+
+// one-shot equality check: pre-processing and online phase on the critical
+// path (see EqCheckPool to pre-process ahead of time)
+bool maliciously_secure_equality_check(int party, bool* input, emp::NetIO* io, std::string filename) {
+    
+    // load circuit file
+    std::shared_ptr<emp::BristolFormat> circuit = load_circuit(filename);
+    emp::BristolFormat& cf = *circuit;
 
     // set up ag2pc network
     emp::C2PC<emp::NetIO> twopc(io, party, &cf);
@@ -119,3 +131,144 @@ bool maliciously_secure_equality_check(int party, bool* input, emp::NetIO* io, s
     return *output;
 }
 
+
+// port distance between the NetIOs of two pool slots: C2PC opens its own
+// helper connections on the ports right after its NetIO's
+const int EQ_POOL_PORT_STRIDE = 32;
+
+// A pool of pre-processed AG2PC instances of one circuit (e.g. eq256): a
+// background thread runs the function-independent and function-dependent
+// phases of the next instances while the pool is idle, so a check only has
+// the online phase on its critical path.
+// Both parties must create the pool with the same parameters and run the
+// same checks: slots are pre-processed and used round-robin. Each slot has
+// its own NetIO, used by one thread at a time.
+class EqCheckPool {
+   private:
+    struct Slot {
+        emp::NetIO* io = nullptr;
+        std::unique_ptr<emp::NetIO> owned_io;
+        std::unique_ptr<emp::C2PC<emp::NetIO>> twopc;
+        bool ready = false;
+    };
+
+    int party;
+    std::shared_ptr<emp::BristolFormat> circuit;
+    std::vector<Slot> slots;
+    // instances the pool may still pre-process, if limited
+    bool limited;
+    size_t left;
+    size_t checks_left;
+    size_t next_check = 0;
+    bool stopping = false;
+    std::mutex m;
+    std::condition_variable cv;
+    std::thread refill_thread;
+
+    // pre-process slots round-robin, each as soon as its instance is used;
+    // stops when every slot is ready on destruction (the same point on both
+    // parties) or when no instance is left
+    void refill() {
+        for (size_t s = 0;; s = (s + 1) % slots.size()) {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&] { return !slots[s].ready || stopping; });
+                if (slots[s].ready || (limited && left == 0)) return;
+                if (limited) left--;
+            }
+            Slot& slot = slots[s];
+            slot.twopc = std::make_unique<emp::C2PC<emp::NetIO>>(
+                slot.io, party, circuit.get());
+            slot.io->flush();
+            slot.twopc->function_independent();
+            slot.io->flush();
+            slot.twopc->function_dependent();
+            slot.io->flush();
+            {
+                std::unique_lock<std::mutex> lock(m);
+                slot.ready = true;
+            }
+            cv.notify_all();
+        }
+    }
+
+    void start(size_t max_instances) {
+        limited = (max_instances > 0);
+        left = max_instances;
+        checks_left = max_instances;
+        refill_thread = std::thread(&EqCheckPool::refill, this);
+    }
+
+   public:
+    // size slots, with NetIOs on port, port + EQ_POOL_PORT_STRIDE, ...;
+    // max_instances bounds the instances pre-processed over the pool's
+    // lifetime (0: no bound)
+    EqCheckPool(int party, const std::string& peer_ip, int port,
+                std::shared_ptr<emp::BristolFormat> circuit, size_t size = 2,
+                size_t max_instances = 0)
+        : party(party), circuit(circuit), slots(size) {
+        for (size_t s = 0; s < size; s++) {
+            slots[s].owned_io = std::make_unique<emp::NetIO>(
+                party == emp::ALICE ? nullptr : peer_ip.c_str(),
+                port + s * EQ_POOL_PORT_STRIDE);
+            slots[s].io = slots[s].owned_io.get();
+        }
+        start(max_instances);
+    }
+
+    // a single slot on an existing NetIO: the next instance is pre-processed
+    // right after each check, so nothing else may use io meanwhile
+    EqCheckPool(int party, emp::NetIO* io,
+                std::shared_ptr<emp::BristolFormat> circuit,
+                size_t max_instances = 0)
+        : party(party), circuit(circuit), slots(1) {
+        slots[0].io = io;
+        start(max_instances);
+    }
+
+    ~EqCheckPool() {
+        {
+            std::unique_lock<std::mutex> lock(m);
+            stopping = true;
+        }
+        cv.notify_all();
+        refill_thread.join();
+    }
+
+    EqCheckPool(const EqCheckPool&) = delete;
+    EqCheckPool& operator=(const EqCheckPool&) = delete;
+
+    // BLOCKING: until the next instance is pre-processed
+    void wait_until_ready() {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [&] { return slots[next_check].ready; });
+    }
+
+    // run the online phase of the next instance (waiting for it to be
+    // pre-processed if needed); output gets cf.n3 bools
+    void run(bool* input, bool* output) {
+        if (limited && checks_left-- == 0) {
+            std::cerr << "Error: no pre-processed instance left in the pool"
+                      << std::endl;
+            std::exit(-1);
+        }
+        Slot& slot = slots[next_check];
+        wait_until_ready();
+        memset(output, false, circuit->n3);
+        slot.twopc->online(input, output, true);
+        {
+            std::unique_lock<std::mutex> lock(m);
+            slot.twopc.reset();
+            slot.ready = false;
+            next_check = (next_check + 1) % slots.size();
+        }
+        cv.notify_all();
+    }
+
+    // equality check: the single output bit
+    bool check(bool* input) {
+        std::unique_ptr<bool[]> output(new bool[circuit->n3]);
+        run(input, output.get());
+        return output[0];
+    }
+};
@@ -6,59 +6,137 @@
 #include "emp-sh2pc/emp-sh2pc.h"
 #include "emp-tool/utils/block.h"
 #include "emp-tool/gc/halfgate_gen.h"
+#include <openssl/evp.h>
+#include <immintrin.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
-// to call from the evaluator
-void get_labels(emp::Integer* input, size_t size, emp::block* labels) {
-    int k = 0;
-    for (size_t i = 0; i < size; i++) {
-        for (size_t j = 0; j < input[i].bits.size(); j++) {
-            labels[k] = input[i].bits[j].bit;
-            k = k + 1;
+// scratch space of the label pipeline: the caller keeps it across calls, so
+// that revealing and hashing large lists does not allocate every time
+struct LabelBuffers {
+    std::vector<emp::block> labels;
+    std::vector<uint64_t> selected;
+    std::unique_ptr<bool[]> bools;
+    size_t bools_size = 0;
+
+    bool* bools_for(size_t n) {
+        if (n > bools_size) {
+            bools.reset(new bool[n]);
+            bools_size = n;
         }
+        return bools.get();
     }
+};
+
+// labels per chunk when hashing: small enough to stay in L2
+const size_t LABEL_CHUNK = 4096;
+
+// an emp::Bit is exactly its wire label, so an Integer's bits are an array
+// of labels
+static_assert(sizeof(emp::Bit) == sizeof(emp::block),
+              "emp::Bit is expected to hold only its label");
+
+// delta with the 0 block cleared
+// TODO is 1 block before 0 block?
+// both work as long as we are consistent
+emp::block delta_one(const emp::block& delta) {
+    emp::block delta1 = delta;
+    ((uint64_t*)(&delta1))[0] = 0;  // 0 before 1
+    //((uint64_t*)(&delta1))[1] = 0; // 1 before 0
+    return delta1;
 }
 
-// to call from the generator, which needs to xor 1s with delta
-void get_labels(emp::Integer* input, size_t size, emp::block* labels, const emp::block delta) {
-    // delta has values in both the 0 and 1 block -- 
-    // clear the 0 block
-    uint64_t * delta_arr = (uint64_t*)(&delta);
-    // TODO is 1 block before 0 block?
-    // both work as long as we are consistent
-    delta_arr[0] = delta_arr[0]^delta_arr[0]; // 0 before 1
-    //delta_arr[1] = delta_arr[1]^delta_arr[1]; // 1 before 0
-    emp::block delta1 = *(emp::block *)(delta_arr);
-    // std::cout << "delta:\t" << delta_arr[0] << "\t" << delta_arr[1] << std::endl;
-    
-    int k = 0;
+// labels[k] = k-th output wire label of input, xored with delta1; returns
+// the number of labels
+size_t gather_labels(emp::block* labels, const emp::Integer* input,
+                     size_t size, const emp::block delta1) {
+    size_t k = 0;
+#ifdef __AVX2__
+    const __m256i delta2 = _mm256_broadcastsi128_si256(delta1);
+#endif
     for (size_t i = 0; i < size; i++) {
-        for (size_t j = 0; j < input[i].bits.size(); j++) {
-            labels[k] = input[i].bits[j].bit ^ delta1;
-            k = k + 1;
+        const emp::block* bits = (const emp::block*)input[i].bits.data();
+        const size_t n = input[i].bits.size();
+        size_t j = 0;
+#ifdef __AVX2__
+        for (; j + 2 <= n; j += 2, k += 2) {
+            __m256i two = _mm256_loadu_si256((const __m256i*)(bits + j));
+            _mm256_storeu_si256((__m256i*)(labels + k),
+                                _mm256_xor_si256(two, delta2));
         }
+#endif
+        for (; j < n; j++, k++) labels[k] = bits[j] ^ delta1;
     }
+    return k;
 }
 
-void apply_labels(uint64_t* output, emp::block* labels, bool* bools, size_t size, size_t bits) {
-    uint64_t* label_ptr = nullptr;
-    for (size_t i = 0; i < size*bits; i++) {
-        label_ptr = (uint64_t*)(&labels[i]);
-        // TODO is 1 block before 0 block? 
-        output[i] = bools[i] ? label_ptr[1] : label_ptr[0]; // 0 before 1
-        //output[i] = bools[i] ? label_ptr[0] : label_ptr[1]; // 1 before 0
+// output[k] = the half of labels[k] selected by bit(k)
+// TODO is 1 block before 0 block? (here 0 before 1)
+template <typename BitAt>
+void select_labels(uint64_t* output, const emp::block* labels, size_t n,
+                   BitAt bit) {
+    size_t k = 0;
+#ifdef __AVX2__
+    // 4 labels at a time: split the halves, blend on the bits, then put the
+    // 4 selected halves back in order
+    for (; k + 4 <= n; k += 4) {
+        __m256i ab = _mm256_loadu_si256((const __m256i*)(labels + k));
+        __m256i cd = _mm256_loadu_si256((const __m256i*)(labels + k + 2));
+        __m256i lo = _mm256_unpacklo_epi64(ab, cd);  // a0 c0 b0 d0
+        __m256i hi = _mm256_unpackhi_epi64(ab, cd);  // a1 c1 b1 d1
+        __m256i mask = _mm256_set_epi64x(
+            -(int64_t)bit(k + 3), -(int64_t)bit(k + 1),
+            -(int64_t)bit(k + 2), -(int64_t)bit(k));
+        __m256i sel = _mm256_blendv_epi8(lo, hi, mask);
+        _mm256_storeu_si256(
+            (__m256i*)(output + k),
+            _mm256_permute4x64_epi64(sel, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+#endif
+    for (; k < n; k++) {
+        const uint64_t* label_ptr = (const uint64_t*)(&labels[k]);
+        output[k] = label_ptr[bit(k) ? 1 : 0];
     }
 }
 
-void apply_labels(uint64_t* output, uint64_t* labels, bool* bools, size_t size, size_t bits) {
+// pack n bools into bits, LSB first
+void pack_bools(uint8_t* bits, const bool* bools, size_t n) {
     size_t k = 0;
-    for (size_t i = 0; i < size*bits; i++) {
-        // TODO is 1 block before 0 block? 
-        output[i] = bools[i] ? labels[k + 1] : labels[k]; // 0 before 1
-        //output[i] = bools[i] ? labels[k] : labels[k + 1]; // 1 before 0
-        k = k + 2;
+    for (; k + 8 <= n; k += 8) {
+        // byte j of x is bool j: the multiplication moves it to bit 56 + j
+        uint64_t x;
+        memcpy(&x, bools + k, 8);
+        bits[k / 8] = (uint8_t)((x * 0x0102040810204080ULL) >> 56);
+    }
+    if (k < n) {
+        bits[k / 8] = 0;
+        for (; k < n; k++)
+            if (bools[k]) bits[k / 8] |= (1 << (k % 8));
     }
 }
 
+// to call from the evaluator
+void get_labels(emp::Integer* input, size_t size, emp::block* labels) {
+    gather_labels(labels, input, size, emp::zero_block);
+}
+
+// to call from the generator, which needs to xor 1s with delta
+void get_labels(emp::Integer* input, size_t size, emp::block* labels, const emp::block delta) {
+    gather_labels(labels, input, size, delta_one(delta));
+}
+
+void apply_labels(uint64_t* output, emp::block* labels, bool* bools, size_t size, size_t bits) {
+    select_labels(output, labels, size * bits,
+                  [bools](size_t k) { return bools[k]; });
+}
+
+// labels as pairs of uint64_t: the same layout as emp::block
+void apply_labels(uint64_t* output, uint64_t* labels, bool* bools, size_t size, size_t bits) {
+    select_labels(output, (const emp::block*)labels, size * bits,
+                  [bools](size_t k) { return bools[k]; });
+}
+
 // based on plain_prot's reveal (line 40 of plain_prot.h)
 // works equally well
 /*
@@ -75,12 +153,102 @@ void reveal_labels_and_bools(uint64_t* output, bool* bools, emp::Integer* input,
     }
 }
 */
+// reveals all the bools in one round, instead of one per Integer
+void reveal_labels_and_bools(uint64_t* output, bool* bools, emp::Integer* input, size_t size, int party,
+                             LabelBuffers& buffers) {
+    size_t n = size * input[0].size();
+    buffers.labels.resize(n);
+    gather_labels(buffers.labels.data(), input, size, emp::zero_block);
+    emp::ProtocolExecution::prot_exec->reveal(bools, party, buffers.labels.data(), n);
+    apply_labels(output, buffers.labels.data(), bools, 1, n);
+}
+
 void reveal_labels_and_bools(uint64_t* output, bool* bools, emp::Integer* input, size_t size, int party) {
-    size_t bits = input[0].size();
-    emp::block* labels = new emp::block[size*bits];
-    get_labels(input, size, labels);
-    for (size_t i = 0; i < size; i++) {
-        input[i].revealBools(&bools[i*bits], party);
+    LabelBuffers buffers;
+    reveal_labels_and_bools(output, bools, input, size, party, buffers);
+}
+
+// incremental SHA3-256, fed one label at a time so that label vectors
+// never need to be materialized
+class LabelHash {
+   private:
+    EVP_MD_CTX* ctx;
+    uint64_t buffer[512];
+    size_t n = 0;
+
+    void flush() {
+        if (n > 0) EVP_DigestUpdate(ctx, buffer, n * sizeof(uint64_t));
+        n = 0;
+    }
+
+   public:
+    static const int DIGEST_SIZE = 32;
+
+    LabelHash() : ctx(EVP_MD_CTX_new()) {
+        if (ctx == nullptr ||
+            EVP_DigestInit_ex(ctx, EVP_sha3_256(), nullptr) != 1) {
+            std::cerr << "Error: cannot initialize SHA3-256" << std::endl;
+            std::exit(-1);
+        }
+    }
+    ~LabelHash() { EVP_MD_CTX_free(ctx); }
+    LabelHash(const LabelHash&) = delete;
+    LabelHash& operator=(const LabelHash&) = delete;
+
+    void put(uint64_t label) {
+        buffer[n++] = label;
+        if (n == sizeof(buffer) / sizeof(uint64_t)) flush();
+    }
+
+    void put(const void* data, size_t bytes) {
+        flush();
+        EVP_DigestUpdate(ctx, data, bytes);
+    }
+
+    // and starts over, so the object can hash the next message
+    void digest(uint8_t* output) {
+        flush();
+        unsigned int length = 0;
+        EVP_DigestFinal_ex(ctx, output, &length);
+        EVP_DigestInit_ex(ctx, EVP_sha3_256(), nullptr);
+    }
+};
+
+// reveal the output bits of input to party, packed (LSB first) into bits,
+// in one round; the other party must call it too, and gets all zeros
+void reveal_packed_bools(uint8_t* bits, const emp::Integer* input,
+                         size_t size, int party, LabelBuffers& buffers) {
+    size_t n = size * input[0].size();
+    buffers.labels.resize(n);
+    gather_labels(buffers.labels.data(), input, size, emp::zero_block);
+    bool* bools = buffers.bools_for(n);
+    emp::ProtocolExecution::prot_exec->reveal(bools, party,
+                                              buffers.labels.data(), n);
+    pack_bools(bits, bools, n);
+}
+
+// hash the output wire labels of input (Integers of the same size) selected
+// by bits (packed, LSB first):
+// the evaluator's own labels w, or, given delta, the generator's labels W(v).
+// labels are selected and hashed LABEL_CHUNK at a time
+void hash_labels(LabelHash& hash, LabelBuffers& buffers,
+                 const emp::Integer* input, size_t size, const uint8_t* bits,
+                 const emp::block* delta = nullptr) {
+    if (size == 0) return;
+    const emp::block delta1 =
+        (delta == nullptr) ? emp::zero_block : delta_one(*delta);
+    const size_t chunk = std::max<size_t>(1, LABEL_CHUNK / input[0].size());
+    buffers.labels.resize(chunk * input[0].size());
+    buffers.selected.resize(chunk * input[0].size());
+    size_t k = 0;
+    for (size_t i = 0; i < size; i += chunk) {
+        size_t n = gather_labels(buffers.labels.data(), input + i,
+                                 std::min(chunk, size - i), delta1);
+        select_labels(buffers.selected.data(), buffers.labels.data(), n,
+                      [bits, k](size_t j) {
+                          return (bits[(k + j) / 8] >> ((k + j) % 8)) & 1;
+                      });
+        hash.put(buffers.selected.data(), n * sizeof(uint64_t));
+        k += n;
     }
-    apply_labels(output, labels, bools, size, bits);
 }
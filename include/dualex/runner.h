@@ -0,0 +1,67 @@
+// Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org>
+// Author: Roberta De Viti
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Thread-based execution of the dual-ex roles (the two role-swapped rounds
+// and the equality checker) in one process.
+// Each role runs on its own thread and sets up its own NetIO and 2PC
+// session, so it has its own circuit and protocol execution: this requires
+// emp-tool and CoVault to be built with THREADING, so that circ_exec and
+// prot_exec are thread-local. Roles hand values (labels, output bits,
+// digests) to each other through Channels.
+namespace dualex {
+
+// blocking in-process queue between two roles
+template <typename T>
+class Channel {
+   private:
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<T> queue;
+
+   public:
+    void push(T value) {
+        {
+            std::unique_lock<std::mutex> lock(m);
+            queue.push_back(std::move(value));
+        }
+        cv.notify_one();
+    }
+
+    // blocks until a value is available
+    T pop() {
+        std::unique_lock<std::mutex> lock(m);
+        cv.wait(lock, [&] { return !queue.empty(); });
+        T value = std::move(queue.front());
+        queue.pop_front();
+        return value;
+    }
+};
+
+// run every role on its own thread and return when all of them are done
+void run_roles(const std::vector<std::function<void()>>& roles) {
+#ifndef THREADING
+    if (roles.size() > 1) {
+        std::cerr << "Error: dual-ex roles on threads need a build with "
+                     "THREADING (thread-local circuit execution)"
+                  << std::endl;
+        std::exit(-1);
+    }
+#endif
+    std::vector<std::thread> threads;
+    threads.reserve(roles.size());
+    for (auto& role : roles) threads.emplace_back(role);
+    for (auto& t : threads) t.join();
+}
+
+}  // namespace dualex
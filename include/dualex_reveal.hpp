@@ -5,18 +5,30 @@
 #include <openssl/rand.h>
 
 #include <boost/interprocess/managed_shared_memory.hpp>
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
 #include <boost/interprocess/anonymous_shared_memory.hpp>
 #include <boost/interprocess/mapped_region.hpp>
+#include <atomic>
+#include <climits>
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <functional>
+#include <thread>
 #include <stdio.h>
 #include <stdlib.h>
+#include <vector>
 #include<unistd.h>
+#include <immintrin.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 
+#include <include/dualex/ag2pc_wrapper.h>
 #include <include/dualex/hash.h>
 #include <include/dualex/labels.h>
+#include <include/embedded_circuits.hpp>
+#include <include/dualex/runner.h>
 #include <include/secrets.hpp>
 
 
@@ -32,86 +44,78 @@ static const uint8_t DEBUG = 1;
 using namespace boost::interprocess;
 
 // for swapping fixed-size patches of ram across processes
-// Specifically, this gives 2 different processes each a (fixed size) patch of RAM, and when they BOTH call swap(), they swap which one owns which patch of RAM (and everything in it). 
+// Specifically, this gives each of its parties (2 by default) a (fixed size) patch of RAM, and when they ALL call swap(), the patches rotate:
+// party i gets the patch party i + 1 had (so with 2 parties, they swap which one owns which patch of RAM, and everything in it).
 // This is useful for very simple inter-process synchornous communication. 
-// note: construct before fork, choose_side after fork (one side must get true, the other false).
-// Ironically, this requires great care that exactly one thread calls choose_side(true), and exactly one thread (in another process) calls choose_side(false).
+// note: construct before fork, choose_side (or choose_party) after fork. Each party must be chosen by exactly one process (choosing one twice fails),
+// and processes that did not choose a party must not swap: that is how the Revealer's three roles share SwappableRams that each have 2 parties.
+// The same works across threads: a copy is another handle on the same patches of RAM, so construct (and init) one, copy it for each thread before choose_side, and have each thread choose_side on its own copy.
+// swap() is a barrier on a sequence number in shared memory: the last party to arrive bumps it, the others spin on it briefly, then sleep on it (futex).
 class SwappableRam {
   private:
-    std::unique_ptr<mapped_region> a;
-    std::unique_ptr<mapped_region> b;
-    std::unique_ptr<mapped_region> mutex_storage_a;
-    std::unique_ptr<mapped_region> mutex_storage_b;
-    std::unique_ptr<mapped_region> mutex_storage_ab;
-    std::unique_ptr<mapped_region> mutex_storage_ba;
-    bool swapped;
-    bool swap_set;
-    bool init_called;
-
-    interprocess_mutex * mutex_a() {
-      return (interprocess_mutex*) (mutex_storage_a->get_address());
-    }
-
-    interprocess_mutex * mutex_b() {
-      return (interprocess_mutex*) (mutex_storage_b->get_address());
+    // lives in shared memory, next to the patches of RAM
+    struct Control {
+      std::atomic<uint32_t> sequence; // swaps completed by all parties
+      std::atomic<uint32_t> arrived;  // parties in the current swap
+      std::atomic<uint32_t> sleepers; // parties waiting in the kernel
+      std::atomic<uint32_t> chosen;   // bitmask of the parties chosen
+    };
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+                  "futexes need lock-free 32-bit atomics");
+
+    // spins before sleeping: a hand-off between roles on other cores usually completes within these.
+    // On a single core, spinning only delays the other party.
+    static int spins() {
+      static const int count = (std::thread::hardware_concurrency() > 1) ? 256 : 0;
+      return count;
     }
 
-    interprocess_mutex * mutex_ab() {
-      return (interprocess_mutex*) (mutex_storage_ab->get_address());
-    }
-
-    interprocess_mutex * mutex_ba() {
-      return (interprocess_mutex*) (mutex_storage_ba->get_address());
-    }
-
-    interprocess_mutex * my_mutex() {
-      if (!swap_set) {
-        std::cerr << "my_mutex() called before choose_side()\n" <<std::flush;
-        return nullptr;
-      }
-      return (swapped ? mutex_a() : mutex_b());
-    }
+    std::vector<std::shared_ptr<mapped_region>> regions;
+    std::shared_ptr<mapped_region> control_storage;
+    uint32_t parties;
+    uint32_t party;
+    uint32_t swaps; // sequence number of my next swap
+    bool swap_set;
+    bool init_called;
 
-    interprocess_mutex * other_mutex() {
-      if (!swap_set) {
-        std::cerr << "other_mutex() called before choose_side()\n" <<std::flush;
-        return nullptr;
-      }
-      return (swapped ? mutex_b() : mutex_a());
+    Control * control() {
+      return (Control *) (control_storage->get_address());
     }
 
-    interprocess_mutex * old_intermediate() {
-      if (!swap_set) {
-        std::cerr << "old_intermediate() called before choose_side()\n" <<std::flush;
-        return nullptr;
-      }
-      return (swapped ? mutex_ba() : mutex_ab());
+    static void futex_wait(std::atomic<uint32_t> * word, const uint32_t value) {
+#ifdef __linux__
+      // not FUTEX_PRIVATE: the word may be shared across processes
+      syscall(SYS_futex, (uint32_t *) word, FUTEX_WAIT, value, nullptr, nullptr, 0);
+#else
+      std::this_thread::yield();
+#endif
     }
 
-    interprocess_mutex * next_intermediate() {
-      if (!swap_set) {
-        std::cerr << "next_intermediate() called before choose_side()\n" <<std::flush;
-        return nullptr;
-      }
-      return (swapped ? mutex_ab() : mutex_ba());
+    static void futex_wake_all(std::atomic<uint32_t> * word) {
+#ifdef __linux__
+      syscall(SYS_futex, (uint32_t *) word, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
     }
 
   public:
     // usage:
     // INIT BEFORE FORK
-    // after fork, one side must call choose_side(true) and the other must call choose_side(false).
+    // after fork, one side must call choose_side(true) and the other must call choose_side(false) (or, with more parties, each calls choose_party).
     // size (in bytes) is the max size of the region of swappable ram. 
-    SwappableRam(const size_t size = 0) {
-      mutex_storage_a = std::make_unique<mapped_region>(anonymous_shared_memory(sizeof(interprocess_mutex)));
-      mutex_storage_b = std::make_unique<mapped_region>(anonymous_shared_memory(sizeof(interprocess_mutex)));
-      mutex_storage_ab = std::make_unique<mapped_region>(anonymous_shared_memory(sizeof(interprocess_mutex)));
-      mutex_storage_ba = std::make_unique<mapped_region>(anonymous_shared_memory(sizeof(interprocess_mutex)));
-
-      (new (mutex_a()) interprocess_mutex())->lock();
-      (new (mutex_b()) interprocess_mutex())->lock();
-      (new (mutex_ab()) interprocess_mutex());
-      (new (mutex_ba()) interprocess_mutex());
-
+    SwappableRam(const size_t size = 0, const size_t parties = 2) {
+      if (parties < 2 || parties > 32) {
+        std::cerr << "SwappableRam needs 2 to 32 parties, not " << parties << std::endl << std::flush;
+        std::exit(-1);
+      }
+      control_storage = std::make_shared<mapped_region>(anonymous_shared_memory(sizeof(Control)));
+      Control * c = new (control()) Control();
+      c->sequence = 0;
+      c->arrived = 0;
+      c->sleepers = 0;
+      c->chosen = 0;
+
+      this->parties = parties;
+      swaps = 0;
       swap_set = false;
       init_called = false;
       if (size > 0) {
@@ -127,29 +131,43 @@ class SwappableRam {
         std::cerr << "SwappableRam.init() called twice!\n" << std::flush;
         return false;
       }
-      a = std::make_unique<mapped_region>(anonymous_shared_memory(size));
-      b = std::make_unique<mapped_region>(anonymous_shared_memory(size));
+      for (uint32_t i = 0; i < parties; ++i) {
+        regions.push_back(std::make_shared<mapped_region>(anonymous_shared_memory(size)));
+      }
       init_called = true;
       return true;
     }
 
-
-    // after fork, one side must call choose_side(true) and the other must call choose_side(false).
-    // returns true on success, false if you've not called init() (or set a size on construction), or if you've previously called choose_side() on this object. 
-    bool choose_side(const bool side) { // one must be true, the other false.
+    // after fork, each party must be chosen by exactly one process.
+    // returns true on success, false if you've not called init() (or set a size on construction), if you've previously called choose_party() on this object,
+    // or if another process has chosen this party.
+    bool choose_party(const size_t party) {
       if (!init_called) {
-        std::cerr << "choose_side() called before init()!\n" << std::flush;
+        std::cerr << "choose_party() called before init()!\n" << std::flush;
         return false;
       }
       if (swap_set) {
-        std::cerr << "choose_side() called twice\n" <<std::flush;
+        std::cerr << "choose_party() called twice\n" <<std::flush;
         return false;
       }
-      swapped = side;
+      if (party >= parties) {
+        std::cerr << "choose_party(" << party << ") with only " << parties << " parties\n" << std::flush;
+        return false;
+      }
+      if (control()->chosen.fetch_or(1u << party) & (1u << party)) {
+        std::cerr << "party " << party << " of a SwappableRam chosen by two processes\n" << std::flush;
+        return false;
+      }
+      this->party = party;
       swap_set = true;
       return true;
     }
 
+    // for 2 parties: one must be true, the other false.
+    bool choose_side(const bool side) {
+      return choose_party(side ? 0 : 1);
+    }
+
     // Get a pointer to the swappable RAM region.
     // Note: technically, it is the pointers that change, not the RAM contents, so call this EVERY TIME YOU WANT TO ACCESS THE STUFF IN SWAPPABLE RAM.
     // returns a nullptr if you've not yet called choose_side.
@@ -160,11 +178,11 @@ class SwappableRam {
         std::cerr << "get() called before choose_side()\n" <<std::flush;
         return nullptr;
       }
-      return (T *) (swapped ? a : b)->get_address();
+      return (T *) regions[(party + swaps) % parties]->get_address();
     }
 
-    // Swap which thread has which patch of RAM.
-    // Blocks until both sides call swap().
+    // Rotate which party has which patch of RAM.
+    // Blocks until all parties call swap().
     // Can be used arbitrarily many times.
     // (ok, so technically, you swap pointers, but whatever).
     bool swap() {
@@ -172,22 +190,44 @@ class SwappableRam {
         std::cerr << "swap() called before choose_side()\n" <<std::flush;
         return false;
       }
-      // the following dance ensures that we have atomic swaps:
-      next_intermediate()->lock();
-      my_mutex()->unlock();
-      swapped = !swapped;
-      my_mutex()->lock();
-      old_intermediate()->unlock();
+      Control * c = control();
+      if (c->sequence.load(std::memory_order_acquire) != swaps) {
+        std::cerr << "swap() out of step with the other parties\n" << std::flush;
+        return false;
+      }
+      if (c->arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == parties) {
+        // last one in: everyone has written their patch, hand them over
+        c->arrived.store(0, std::memory_order_relaxed);
+        c->sequence.store(swaps + 1);
+        if (c->sleepers.load() > 0) {
+          futex_wake_all(&c->sequence);
+        }
+      } else {
+        const int max_spins = spins();
+        for (int spin = 0; c->sequence.load(std::memory_order_acquire) == swaps; ++spin) {
+          if (spin < max_spins) {
+            _mm_pause();
+          } else {
+            c->sleepers.fetch_add(1);
+            futex_wait(&c->sequence, swaps);
+            c->sleepers.fetch_sub(1);
+          }
+        }
+      }
+      ++swaps;
       return true;
     }
 };
 
 // Used for the DualEx revealer.
 // Represents a process requesting whether it wants to perform another reveal operation, and if so, which Side to reveal the information to, and how many bits. 
+// The eq checker adds the labels of every reveal to a running hash, and only runs the equality check on it when check_now is set.
+// revealable_bits == 0 means there are no labels with this request (it only asks for the check).
 struct RevealRequest {
   bool want_reveal;
   secrets::Side reveal_side;
   uint64_t revealable_bits;
+  bool check_now;
 };
 
 
@@ -198,14 +238,18 @@ struct RevealRequest {
 // - An Equality Checker (on one side this will be a garbler, on another a non-garbler)
 // When both the Garbler and Non-Garbler from both sides request a reveal, we reveal the output (to the given Side), and then ask the Equality Checker to start checking whether the outputs Sides got were equal. 
 // Note that you must check whether the equality checker got an "equal" result before performing the next reveal. 
+// Reveals can also be batched: with set_reveals_per_eq_check(n), the labels of n reveals are hashed together and checked with one equality check
+// (n = 0: only when check_pending_reveals() is called). Until that check, a cheating party can learn up to n outputs before being caught.
+// The 3 roles can also be threads of one process (see run_and_setup): a copy of a Revealer shares its SwappableRams, so each thread gets its own copy.
 class Revealer {
-// DANGER: we now have three processes, and all of them have pointers to the same SwappableRams, which are really designed for 2 processes, so... it seems to work so far...
+// All three processes have handles on all the SwappableRams, but each SwappableRam has exactly 2 parties (see begin_*_process()), and choose_side() refuses a third.
 
   private:
     size_t bits;
+    // each is this role's own handle on RAM shared with the other roles
     std::unique_ptr<SwappableRam> garbler_labels;
     std::unique_ptr<SwappableRam> non_garbler_labels;
-    std::unique_ptr<bool> garbler_bools;
+    std::shared_ptr<bool> garbler_bools;
     std::unique_ptr<SwappableRam> non_garbler_bools;
 
     std::unique_ptr<SwappableRam> revealed_value;
@@ -215,8 +259,8 @@ class Revealer {
     std::unique_ptr<SwappableRam> garbler_eq_check_result;
     std::unique_ptr<SwappableRam> non_garbler_eq_check_result;
 
-    std::unique_ptr<emp::BristolFormat> eq_circuit;
-    std::unique_ptr<emp::Integer> encryptMe;
+    std::shared_ptr<emp::BristolFormat> eq_circuit;
+    std::shared_ptr<emp::Integer> encryptMe;
 
     bool i_am_left;
     bool i_am_eq_checker;
@@ -224,6 +268,10 @@ class Revealer {
     bool ready_to_request_eq_check;
     bool init_set;
 
+    // reveals per equality check (0: only on check_pending_reveals()), and how many have not been checked yet
+    size_t reveals_per_eq_check;
+    size_t unchecked_reveals;
+
     bool side_chosen;
     uint64_t nonce[5];
 
@@ -231,6 +279,10 @@ class Revealer {
     emp::AES_128_CTR_Calculator * aes;
     emp::NetIO * io;
 
+    static std::unique_ptr<SwappableRam> copy_ram(const std::unique_ptr<SwappableRam>& ram) {
+      return ram ? std::make_unique<SwappableRam>(*ram) : nullptr;
+    }
+
   public:
 
 
@@ -254,11 +306,44 @@ class Revealer {
       side_chosen = false;
       eq_check_in_progress = false;
       ready_to_request_eq_check = false;
+      reveals_per_eq_check = 1;
+      unchecked_reveals = 0;
       if ((bits > 0) && (side == secrets::LEFT || side == secrets::RIGHT)) {
         init(side, bits);
       }
     }
 
+    // a copy for another thread: it has its own handles on the same SwappableRams, so copy after init() and before choose_side().
+    Revealer(const Revealer& other)
+        : bits(other.bits),
+          garbler_labels(copy_ram(other.garbler_labels)),
+          non_garbler_labels(copy_ram(other.non_garbler_labels)),
+          garbler_bools(other.garbler_bools),
+          non_garbler_bools(copy_ram(other.non_garbler_bools)),
+          revealed_value(copy_ram(other.revealed_value)),
+          garbler_wants_eq_check(copy_ram(other.garbler_wants_eq_check)),
+          non_garbler_wants_eq_check(copy_ram(other.non_garbler_wants_eq_check)),
+          garbler_eq_check_result(copy_ram(other.garbler_eq_check_result)),
+          non_garbler_eq_check_result(copy_ram(other.non_garbler_eq_check_result)),
+          eq_circuit(other.eq_circuit),
+          encryptMe(other.encryptMe),
+          i_am_left(other.i_am_left),
+          i_am_eq_checker(other.i_am_eq_checker),
+          eq_check_in_progress(other.eq_check_in_progress),
+          ready_to_request_eq_check(other.ready_to_request_eq_check),
+          init_set(other.init_set),
+          reveals_per_eq_check(other.reveals_per_eq_check),
+          unchecked_reveals(other.unchecked_reveals),
+          side_chosen(other.side_chosen),
+          reusable_secrets(other.reusable_secrets),
+          aes(other.aes),
+          io(other.io) {
+      if (side_chosen) {
+        std::cerr << "Revealer copied after choose_side()!" << std::endl << std::flush;
+      }
+      memcpy(nonce, other.nonce, sizeof(nonce));
+    }
+
     // you can specify which Side this machine is, as well as the maximum revealable bits, at construction or in init() 
     // (not both)
     bool init(const secrets::Side side, const size_t bits) {
@@ -268,7 +353,7 @@ class Revealer {
       }
       i_am_left = (side == secrets::LEFT);
       garbler_labels = std::unique_ptr<SwappableRam>(new SwappableRam(sizeof(emp::block) * bits));
-      garbler_bools = std::unique_ptr<bool>(new bool[bits]);
+      garbler_bools = std::shared_ptr<bool>(new bool[bits], std::default_delete<bool[]>());
       non_garbler_labels = std::unique_ptr<SwappableRam>(new SwappableRam(sizeof(emp::block) * bits));
       non_garbler_bools = std::unique_ptr<SwappableRam>(new SwappableRam(sizeof(bool) * bits));
       revealed_value = std::unique_ptr<SwappableRam>(new SwappableRam(((sizeof(uint8_t) * bits) + 7)/8));
@@ -283,9 +368,15 @@ class Revealer {
       return true;
     }
 
+    // how many reveals share one equality check (default 1: every reveal is checked on its own; 0: only on check_pending_reveals()).
+    // Call before fork (or run_and_setup), with the same value on both Sides.
+    void set_reveals_per_eq_check(const size_t reveals) {reveals_per_eq_check = reveals;}
+
     secrets::Reusable_Secrets * get_reusable_secrets() {return reusable_secrets;}
     emp::AES_128_CTR_Calculator * get_aes() {return aes;}
     emp::NetIO * get_io() {return io;}
+    // the most bits one reveal() can reveal (set at construction or in init())
+    size_t get_revealable_bits() {return bits;}
 
     // useful for debug printouts
     auto preamble() {
@@ -324,6 +415,7 @@ class Revealer {
         std::cerr << preamble() << "eq check results requested but no eq check is in progress!" << std::endl << std::flush;
         return false;
       }
+      flush_before_wait(io);
       if (is_garbler()) {
         garbler_eq_check_result->swap();
         eq_check_in_progress = false;
@@ -341,37 +433,76 @@ class Revealer {
     // tell the eq_check processes they can begin eq checking.
     // Note: if this has been called before, this will block until the previous get_eq_check_results is called!
     // REVEAL WILL CALL THIS
+    // Note: with reveals_per_eq_check != 1, this only hands the labels over, until the reveal that completes the batch.
     bool request_eq_check(const secrets::Side reveal_side = secrets::BOTH, const uint64_t revealable_bits = 0) {
+      ++unchecked_reveals;
+      const bool check_now = (reveals_per_eq_check > 0) && (unchecked_reveals >= reveals_per_eq_check);
+      return send_request(reveal_side, (revealable_bits == 0) ? bits : revealable_bits, check_now);
+    }
+
+    // BLOCKING
+    // check all reveals so far: waits for the eq check in progress (if any), then requests and waits for one over the reveals not yet checked (if any).
+    // returns whether all of them were good
+    bool check_pending_reveals() {
+      bool is_equal = true;
+      if (eq_check_in_progress) {
+        is_equal = get_eq_check_results();
+      }
+      if (unchecked_reveals > 0) {
+        is_equal = send_request(secrets::BOTH, 0, true) && get_eq_check_results() && is_equal;
+      }
+      return is_equal;
+    }
+
+  private:
+    // hand this reveal's labels (if revealable_bits > 0) to the eq checker, and with check_now ask it to check everything since the last check
+    bool send_request(const secrets::Side reveal_side, const uint64_t revealable_bits, const bool check_now) {
       if (!ready_to_request_eq_check) {
         std::cerr << preamble() << "not ready to request eq check!" << std::endl << std::flush;
         return false;
       }
       ready_to_request_eq_check = false;
       if (DEBUG > 0) {
-        std::cout << preamble() << "requesting eq check. revealable_bits: " << revealable_bits << std::endl << std::flush;
+        std::cout << preamble() << "requesting eq check. revealable_bits: " << revealable_bits << " check_now: " << check_now << std::endl << std::flush;
       }
       RevealRequest * reveal_request =
         is_garbler() ? garbler_wants_eq_check->get<RevealRequest>() : non_garbler_wants_eq_check->get<RevealRequest>();
       reveal_request->want_reveal = true;
       reveal_request->reveal_side = reveal_side;
-      reveal_request->revealable_bits = (revealable_bits == 0) ? bits : revealable_bits;
+      reveal_request->revealable_bits = revealable_bits;
+      reveal_request->check_now = check_now;
       if (is_garbler()) {
         garbler_wants_eq_check->swap();
-        garbler_labels->swap();
+        if (revealable_bits > 0) {
+          garbler_labels->swap();
+        }
       } else {
         non_garbler_wants_eq_check->swap();
-        non_garbler_labels->swap();
-        non_garbler_bools->swap();
+        if (revealable_bits > 0) {
+          non_garbler_labels->swap();
+          non_garbler_bools->swap();
+        }
+      }
+      if (check_now) {
+        unchecked_reveals = 0;
+        eq_check_in_progress = true;
+      } else {
+        ready_to_request_eq_check = true;
       }
-      eq_check_in_progress = true;
       return true;
     }
 
+  public:
+
     // BLOCKING
     // when we're done eq checking, call this:
     // Note: if request_eq_check has been called before, this will block until the previous get_eq_check_results is called!
     // Note: don't call get_eq_check_results or request_eq_check ro stop_eq_checker after this.
     bool stop_eq_checker() {
+      if (unchecked_reveals > 0) {
+        std::cerr << preamble() << "can't stop eq checker with reveals not yet checked. Try check_pending_reveals()." << std::endl << std::flush;
+        return false;
+      }
       if (!ready_to_request_eq_check) {
         std::cerr << preamble() << "can't stop eq checker until we're ready to request eq check. Try get_eq_check_results()." << std::endl << std::flush;
         return false;
@@ -396,7 +527,10 @@ class Revealer {
       uint64_t hashMe[bits * 2];
       uint8_t hash_value[32];
       secrets::Side reveal_side;
-      uint64_t revealable_bits;
+      uint64_t revealable_bits = 0;
+      bool check_now;
+      // labels of all reveals since the last check
+      LabelHash running_hash;
       if(!(   garbler_wants_eq_check->choose_side(true)
            && non_garbler_wants_eq_check->choose_side(true)
            && garbler_eq_check_result->choose_side(true)
@@ -415,21 +549,11 @@ class Revealer {
       // but I'm going to pick that apart because I don't want input to be a string, and I want to return a bool.
       io->sync();
       if (DEBUG > 0) {
-        std::cout << preamble() << "preparing to make C2PC. revealable_bits: " << revealable_bits << std::endl << std::flush;
-      }
-      emp::C2PC<emp::NetIO> twopc = emp::C2PC<emp::NetIO>(io, party(), eq_circuit.get());
-      if (DEBUG > 0) {
-        std::cout << preamble() << "C2PC created." << std::endl << std::flush;
+        std::cout << preamble() << "preparing to make the eq check pool." << std::endl << std::flush;
       }
-      io->sync();
-      if (DEBUG > 0) {
-        std::cout << preamble() << "attempting twopc.function_independent" << std::endl << std::flush;
-      }
-      twopc.function_independent();
-      if (DEBUG > 0) {
-        std::cout << preamble() << "twopc.function_independent complete." << std::endl << std::flush;
-      }
-      io->sync();
+      // the pool pre-processes the next C2PC instance on io in the background, right after each check,
+      // so from here on only the pool uses io
+      EqCheckPool eq_pool(party(), io, eq_circuit);
 
 
       garbler_wants_eq_check->swap();
@@ -450,14 +574,21 @@ class Revealer {
           std::cerr << preamble() << "garbler and non-garbler requested different revealable_bits" << std::endl << std::flush;
         }
         revealable_bits = garbler_wants_eq_check->get<RevealRequest>()->revealable_bits;
+        if ((garbler_wants_eq_check->get<RevealRequest>()->check_now) !=
+            (non_garbler_wants_eq_check->get<RevealRequest>()->check_now)) {
+          std::cerr << preamble() << "garbler and non-garbler disagree on whether to check now" << std::endl << std::flush;
+        }
+        check_now = garbler_wants_eq_check->get<RevealRequest>()->check_now;
 
-        garbler_labels->swap();
-        non_garbler_labels->swap();
-        non_garbler_bools->swap();
-
-        io->sync();
+        if (revealable_bits > 0) {
+          garbler_labels->swap();
+          non_garbler_labels->swap();
+          non_garbler_bools->swap();
+        }
 
-        if (is_garbler()) {
+        if (revealable_bits == 0) {
+          // only a request to check
+        } else if (is_garbler()) {
           apply_labels(  hashMe,                   garbler_labels->get<emp::block>(),     non_garbler_bools->get<bool>(), 1, revealable_bits); // W_big
           apply_labels(&(hashMe[revealable_bits]), non_garbler_labels->get<emp::block>(), non_garbler_bools->get<bool>(), 1, revealable_bits);//w_little
         } else {
@@ -492,7 +623,14 @@ class Revealer {
           std::cout << std::dec << std::endl << std::flush;
         }
 
-        emp::sha3_256<uint64_t>(hash_value, hashMe, revealable_bits * 2);
+        running_hash.put(hashMe, revealable_bits * 2 * sizeof(uint64_t));
+        if (!check_now) {
+          // wait for the next eq request
+          garbler_wants_eq_check->swap();
+          non_garbler_wants_eq_check->swap();
+          continue;
+        }
+        running_hash.digest(hash_value);
 
         if (DEBUG > 1) {
           std::cout << preamble() << " hash: ";
@@ -512,14 +650,8 @@ class Revealer {
           std::cout << std::endl;
         }
 
-        // Actual malicious equality check:
-        io->sync();
-        twopc.function_dependent(); // do we have to do this again for each reveal?
-        if (DEBUG > 0) {
-          std::cout << preamble() << "I have completed side setup." << std::endl << std::flush;
-        }
-        io->sync();
-        twopc.online(input, &is_equal, true);
+        // Actual malicious equality check (only its online phase, unless the pool is still pre-processing):
+        is_equal = eq_pool.check(input);
         if (!is_equal) {
           std::cerr << preamble() << "after malicious eq circuit computation, got output 0 instead of 1" << std::endl << std::flush;
         } else {
@@ -527,7 +659,6 @@ class Revealer {
             std::cout << preamble() << "malicious eq circuit computation returned 1" << std::endl << std::flush;
           }
         }
-        io->sync();
 
         // send over the results
         (*(garbler_eq_check_result->get<bool>())) = is_equal;
@@ -586,13 +717,12 @@ class Revealer {
       }
       aes = aes_128_ctr_calculator;
       io = io_this_side_of_fork;
-      encryptMe = std::unique_ptr<emp::Integer>(new emp::Integer());
+      encryptMe = std::make_shared<emp::Integer>();
       if (DEBUG > 1) {
         std::cout << preamble() << "preparing to get SwappableRam to choose sides" << std::endl << std::flush;
       }
 
-      // TODO (low priority): hard-code this circuit file so we're not reading it at runtime.
-      eq_circuit = std::unique_ptr<emp::BristolFormat>(new emp::BristolFormat("circuits/eq256.txt"));
+      eq_circuit = std::make_shared<emp::BristolFormat>(circuits::load(circuits::eq256));
       if (DEBUG > 0) {
         std::cout << preamble() << "BristolFormat circuit created." << std::endl << std::flush;
       }
@@ -735,7 +865,7 @@ class Revealer {
           std::cerr << preamble() << "something went wrong in encrypt" << std::endl << std::flush;
           return false;
         }
-        io->sync();
+        debug_sync(io);
         if (DEBUG > 0) {
           std::cout << preamble() << "encryption complete." << std::endl << std::flush;
         }
@@ -749,7 +879,8 @@ class Revealer {
       if (DEBUG > 1) {
         std::cout << preamble() << "encryptMe has revealed bools." << std::endl << std::flush;
       }
-      io->sync();
+      // the garbler waits on its non-garbler next: the bools must be on their way to BOB
+      flush_before_wait(io);
 
       // actually output the value on reveal_side.
       // this does basically nothing on non-reveal side.
@@ -776,7 +907,7 @@ class Revealer {
       } if (DEBUG > 0) {
         std::cout << preamble() << "reveals_complete." << std::endl << std::flush;
       }
-      io->sync();
+      flush_before_wait(io);
       if (is_garbler()) {
         emp::HalfGateGen<emp::NetIO>* half_gate_gen = dynamic_cast<emp::HalfGateGen<emp::NetIO>*>(CircuitExecution::circ_exec);
         if (DEBUG > 1) {
@@ -809,29 +940,24 @@ int fork_n_processes(const size_t n) {
   return 0;
 }
 
-// Spin up a process for Garbler, a process for Non-Garbler, and 1 process per Revealer for EQ_Checker.
-// Calls choose_side() with all the necessary setup.
-// returns:
-//  - NEGATIVE: fork error (this is an output directly from fork)
-//  - 0: Garbler (ALICE) this is also the parent process.
-//  - 1: Non-Garbler (BOB) this is a child process
-//  - > 1: this is an EQ checker, and it has finished eq checking. you should probably termiante now.
-int fork_and_setup(Revealer revealers[],
-                   const size_t revealers_count,
-                   std::unique_ptr<secrets::Reusable_Secrets> * reusable_secrets, // we'll initialize this
-                   std::unique_ptr<emp::AES_128_CTR_Calculator> * aes_128_ctr_calculator, // we'll initialize this
-                   std::unique_ptr<emp::NetIO> * io, // we'll initialize this
-                   const std::string * left_ip,
-                   const std::string * right_ip,
-                   const uint32_t left_alice_port,
-                   const uint32_t left_bob_port,
-                   const uint32_t right_alice_port,
-                   const uint32_t right_bob_port,
-                   const uint32_t left_eq_port[], // we need one port for each revealer
-                   const uint32_t right_eq_port[], // we need one port for each revealer
-                   const bool left_side_of_eq_checker_is_garbler[], // we need one for each revealer
-                   const bool i_am_left) {
-  const int me = fork_n_processes(revealers_count + 2);
+// Set up role me (as numbered by fork_and_setup) in this process or thread: its NetIO, 2PC session, secrets and AES, then choose_side() on every Revealer.
+// Returns me, or negative on error. An eq checker returns once it has finished eq checking.
+int setup_role(const int me,
+               Revealer revealers[],
+               const size_t revealers_count,
+               std::unique_ptr<secrets::Reusable_Secrets> * reusable_secrets, // we'll initialize this
+               std::unique_ptr<emp::AES_128_CTR_Calculator> * aes_128_ctr_calculator, // we'll initialize this
+               std::unique_ptr<emp::NetIO> * io, // we'll initialize this
+               const std::string * left_ip,
+               const std::string * right_ip,
+               const uint32_t left_alice_port,
+               const uint32_t left_bob_port,
+               const uint32_t right_alice_port,
+               const uint32_t right_bob_port,
+               const uint32_t left_eq_port[], // we need one port for each revealer
+               const uint32_t right_eq_port[], // we need one port for each revealer
+               const bool left_side_of_eq_checker_is_garbler[], // we need one for each revealer
+               const bool i_am_left) {
   if (me == 0) { // LAUNCH ALICE
     if (DEBUG > 1) {
       std::cout << "Garbler (alice) process beginning." << std::endl << std::flush;
@@ -912,4 +1038,83 @@ int fork_and_setup(Revealer revealers[],
   } // if me < 0, that's a fork error, which we just return anyway.
   return me; // indicates which process you're looking at.
 }
+
+// Spin up a process for Garbler, a process for Non-Garbler, and 1 process per Revealer for EQ_Checker.
+// Calls choose_side() with all the necessary setup.
+// returns:
+//  - NEGATIVE: fork error (this is an output directly from fork)
+//  - 0: Garbler (ALICE) this is also the parent process.
+//  - 1: Non-Garbler (BOB) this is a child process
+//  - > 1: this is an EQ checker, and it has finished eq checking. you should probably termiante now.
+int fork_and_setup(Revealer revealers[],
+                   const size_t revealers_count,
+                   std::unique_ptr<secrets::Reusable_Secrets> * reusable_secrets, // we'll initialize this
+                   std::unique_ptr<emp::AES_128_CTR_Calculator> * aes_128_ctr_calculator, // we'll initialize this
+                   std::unique_ptr<emp::NetIO> * io, // we'll initialize this
+                   const std::string * left_ip,
+                   const std::string * right_ip,
+                   const uint32_t left_alice_port,
+                   const uint32_t left_bob_port,
+                   const uint32_t right_alice_port,
+                   const uint32_t right_bob_port,
+                   const uint32_t left_eq_port[], // we need one port for each revealer
+                   const uint32_t right_eq_port[], // we need one port for each revealer
+                   const bool left_side_of_eq_checker_is_garbler[], // we need one for each revealer
+                   const bool i_am_left) {
+  const int me = fork_n_processes(revealers_count + 2);
+  if (me < 0) {
+    return me;
+  }
+  return setup_role(me, revealers, revealers_count, reusable_secrets, aes_128_ctr_calculator, io,
+                    left_ip, right_ip, left_alice_port, left_bob_port, right_alice_port, right_bob_port,
+                    left_eq_port, right_eq_port, left_side_of_eq_checker_is_garbler, i_am_left);
+}
+
+// Thread version of fork_and_setup: runs the Garbler, the Non-Garbler and 1 EQ_Checker per Revealer as threads of this process (this needs a build with THREADING).
+// Each thread gets its own copy of the revealers, its own NetIO, secrets and AES, and after setup calls
+// role(me, its revealers, its secrets, its aes, its io), with me numbered as in fork_and_setup (an EQ_Checker has finished eq checking by then).
+// Returns once all threads are done; false if any of them could not be set up.
+typedef std::function<void(int, Revealer[], secrets::Reusable_Secrets *, emp::AES_128_CTR_Calculator *, emp::NetIO *)> RoleFunction;
+bool run_and_setup(Revealer revealers[],
+                   const size_t revealers_count,
+                   const std::string * left_ip,
+                   const std::string * right_ip,
+                   const uint32_t left_alice_port,
+                   const uint32_t left_bob_port,
+                   const uint32_t right_alice_port,
+                   const uint32_t right_bob_port,
+                   const uint32_t left_eq_port[], // we need one port for each revealer
+                   const uint32_t right_eq_port[], // we need one port for each revealer
+                   const bool left_side_of_eq_checker_is_garbler[], // we need one for each revealer
+                   const bool i_am_left,
+                   const RoleFunction & role) {
+  // copy before any thread chooses a side
+  std::vector<std::vector<Revealer>> views;
+  views.reserve(revealers_count + 2);
+  for (size_t me = 0; me < revealers_count + 2; ++me) {
+    views.emplace_back(revealers, revealers + revealers_count);
+  }
+  std::vector<int> results(revealers_count + 2, 0);
+  std::vector<std::function<void()>> roles;
+  for (size_t me = 0; me < revealers_count + 2; ++me) {
+    roles.push_back([&, me] {
+      std::unique_ptr<secrets::Reusable_Secrets> reusable_secrets;
+      std::unique_ptr<emp::AES_128_CTR_Calculator> aes;
+      std::unique_ptr<emp::NetIO> io;
+      results[me] = setup_role(me, views[me].data(), revealers_count, &reusable_secrets, &aes, &io,
+                               left_ip, right_ip, left_alice_port, left_bob_port, right_alice_port, right_bob_port,
+                               left_eq_port, right_eq_port, left_side_of_eq_checker_is_garbler, i_am_left);
+      if (results[me] >= 0) {
+        role(me, views[me].data(), reusable_secrets.get(), aes.get(), io.get());
+      }
+    });
+  }
+  run_roles(roles);
+  for (const int result : results) {
+    if (result < 0) {
+      return false;
+    }
+  }
+  return true;
+}
 }
@@ -0,0 +1,40 @@
+// Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org>
+// Author: Roberta De Viti
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <emp-tool/emp-tool.h>
+
+// Bristol format circuits compiled into the binaries (link embedded_circuits),
+// generated at build time from circuits/ by circuits/embed_circuit.py: no
+// parsing at startup, and no dependency on the current working directory.
+namespace circuits {
+
+struct Embedded {
+    int num_gate;
+    int num_wire;
+    int n1;
+    int n2;
+    int n3;
+    // 4 ints per gate: input 1, input 2, output, type (emp's gate types)
+    const int* gates;
+};
+
+// circuits/eq256.txt
+extern const Embedded eq256;
+// circuits/bristol_format/sha-256.txt
+extern const Embedded sha_256;
+// circuits/bristol_format/sha-1.txt
+extern const Embedded sha_1;
+// circuits/bristol_format/AES-non-expanded.txt
+extern const Embedded aes_non_expanded;
+
+// a BristolFormat of the circuit, without parsing: the gates are only copied
+// (inline: the generated circuit sources include this header too)
+inline emp::BristolFormat load(const Embedded& circuit) {
+    return emp::BristolFormat(circuit.num_gate, circuit.num_wire, circuit.n1,
+                              circuit.n2, circuit.n3,
+                              const_cast<int*>(circuit.gates));
+}
+
+}  // namespace circuits
@@ -1,5 +1,6 @@
 #pragma once
 #include <emp-sh2pc/emp-sh2pc.h>
+#include "include/embedded_circuits.hpp"
 #include <boost/functional/hash.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
 #include <unordered_map>
@@ -639,7 +640,7 @@ void sha256Integers(emp::Integer hash, const emp::Integer integers[],
     for (size_t i = 0; i < 512; ++i) {
         bools[i] = false;
     }
-    BristolFormat cf("circuits/bristol_format/sha-256.txt");
+    BristolFormat cf = circuits::load(circuits::sha_256);
     emp::Integer hashMe;
     emp::Integer nextHash;
     hashMe.init(bools, 512, emp::PUBLIC);
@@ -674,7 +675,7 @@ void sha1Integers(emp::Integer hash, const emp::Integer integers[],
     for (size_t i = 0; i < 512; ++i) {
         bools[i] = false;
     }
-    BristolFormat cf("circuits/bristol_format/sha-1.txt");
+    BristolFormat cf = circuits::load(circuits::sha_1);
     emp::Integer hashMe;
     emp::Integer nextHash;
     hashMe.init(bools, 512, emp::PUBLIC);
@@ -762,7 +763,7 @@ void aes128Integers(emp::Integer *output, const emp::Integer *key,
     emp::Integer nextChunk;
     nextChunk.init(bools, 128, emp::PUBLIC);
 
-    BristolFormat cf("circuits/bristol_format/AES-non-expanded.txt");
+    BristolFormat cf = circuits::load(circuits::aes_non_expanded);
 
     size_t index = 0;
     for (size_t i = 0; i < count; ++i) {
@@ -7,6 +7,7 @@
 #include <include/encounter.hpp>
 #include <include/bloomfilter.h>
 #include <include/secrets.hpp>
+#include <include/sort_join.hpp>
 #include <include/store_path_encounter.hpp>
 #include <unordered_map>
 #include <immintrin.h>
@@ -18,6 +19,81 @@ uint64_t time_now_millis() {
     return (uint64_t) std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
+// the SORT_JOIN count of flow(): the number of distinct sink devices with a valid encounter with a device that a source
+// device met (validly) earlier, or that is a source itself with include_direct_source_to_sink_edges.
+// The source and sink ids and the encounter list are sorted once by (encountered id, time, tag), with the ids first in
+// each group and source encounters before sink encounters at the same time, and one pass carries, per encountered id,
+// whether it is a source or a sink and whether a source reached it yet.
+// encounter_list entries are as in flow(): encountered (256 bits), device (256 bits), then a source bit.
+emp::Integer flow_sort_join(const emp::Integer encounter_list[],
+                            const emp::Integer encounter_list_times[],
+                            const size_t encounter_list_size,
+                            const emp::Integer source_device_ids[],
+                            const size_t source_count,
+                            const emp::Integer sink_device_ids[],
+                            const size_t sink_count,
+                            const emp::Integer * start_time,
+                            const emp::Integer * end_time,
+                            const bool include_direct_source_to_sink_edges) {
+  const size_t id_bits = 8 * sizeof(encounter::DeviceID);
+  const size_t time_bits = 8 * sizeof(encounter::Timestamp);
+  const size_t size = source_count + sink_count + encounter_list_size;
+  const emp::Bit zero(false, emp::PUBLIC);
+  const emp::Bit one(true, emp::PUBLIC);
+  const emp::Integer no_time(time_bits, 0, emp::PUBLIC);
+  const emp::Integer no_device(id_bits, 0, emp::PUBLIC);
+  const emp::Integer invalid = bit_integer(zero);
+  // tags, low bit first: 0 source id, 1 sink id, 2 source encounter, 3 sink encounter
+  emp::Integer tag;
+  tag.bits.resize(2);
+  std::vector<emp::Integer> keys(size);
+  std::vector<emp::Integer> payloads(size);
+  size_t r = 0;
+  for (size_t i = 0; i < source_count + sink_count; ++i, ++r) {
+    const bool is_source = (i < source_count);
+    tag.bits[0] = is_source ? zero : one;
+    tag.bits[1] = zero;
+    keys[r] = concat({&tag, &no_time, is_source ? &(source_device_ids[i]) : &(sink_device_ids[i - source_count])});
+    payloads[r] = concat({&no_device, &invalid});
+  }
+  for (size_t i = 0; i < encounter_list_size; ++i, ++r) {
+    const emp::Integer encountered = sub_integer(encounter_list[i], 0, id_bits);
+    const emp::Integer device = sub_integer(encounter_list[i], id_bits, id_bits);
+    const emp::Integer valid = bit_integer((*start_time < encounter_list_times[i]) & (encounter_list_times[i] < *end_time));
+    tag.bits[0] = !(encounter_list[i].bits[2 * id_bits]);
+    tag.bits[1] = one;
+    keys[r] = concat({&tag, &(encounter_list_times[i]), &encountered});
+    payloads[r] = concat({&device, &valid});
+  }
+  emp::sort(keys.data(), (int) size, payloads.data(), true);
+
+  const std::vector<emp::Bit> heads = id_heads(keys, 2 + time_bits, id_bits);
+  std::vector<emp::Integer> hit_devices(size);
+  std::vector<emp::Bit> hits(size);
+  emp::Bit in_source;
+  emp::Bit in_sink;
+  emp::Bit reached;
+  for (r = 0; r < size; ++r) {
+    const emp::Bit is_encounter = keys[r].bits[1];
+    const emp::Bit is_sink = keys[r].bits[0];
+    const emp::Bit is_source_id = (!is_encounter) & (!is_sink);
+    const emp::Bit is_sink_id = (!is_encounter) & is_sink;
+    const emp::Bit valid = payloads[r].bits[id_bits];
+    // the ids come first in their group: by its encounters, in_source and in_sink are final
+    const emp::Bit same = (r == 0) ? zero : !heads[r];
+    in_source = is_source_id | (same & in_source);
+    in_sink = is_sink_id | (same & in_sink);
+    const emp::Bit excluded = include_direct_source_to_sink_edges ? in_sink : (in_sink | in_source);
+    reached = (same & reached) | (is_encounter & (!is_sink) & valid & (!excluded));
+    if (include_direct_source_to_sink_edges) {
+      reached = reached | is_source_id;
+    }
+    hits[r] = is_encounter & is_sink & valid & reached;
+    hit_devices[r] = sub_integer(payloads[r], 0, id_bits);
+  }
+  return count_groups_with_hits(hit_devices, hits);
+}
+
 template <size_t element_size, int n_hashes>
 bool flow(ShuffleStore * shuffle_store,
           dualex::Revealer * revealer,         
@@ -44,11 +120,11 @@ bool flow(ShuffleStore * shuffle_store,
           const size_t encountered_filter_n_elements = 1000,
           const size_t already_infected_filter_n_elements = 0, // 0 means use sink_count.
           const bool include_direct_source_to_sink_edges = false,
-          const bool debug_printouts = false
+          const bool debug_printouts = false,
+          const WalkStrategy strategy = WalkStrategy::BLOOM_FILTER // SORT_JOIN joins all the encounters fetched
           ) {
   std::cout << revealer->preamble() << "starting flow()" << std::endl << std::flush;
-  revealer->get_io()->sync();
-  std::cout << revealer->preamble() << "sync() complete" << std::endl << std::flush;
+  debug_sync(revealer->get_io());
   const size_t encounter_list_size = encounters_per_device_per_shuffle * (source_count + sink_count) * shuffle_count;
   const size_t encounters_to_walk_through = (total_encounters_to_walk_through == 0) ? encounter_list_size : total_encounters_to_walk_through;
 
@@ -64,20 +140,26 @@ bool flow(ShuffleStore * shuffle_store,
   emp::Integer source_previous[source_count];
   emp::Integer sink_previous[sink_count];
   emp::Integer encountered;
-  emp::Integer previous;
-  emp::Integer duration;
-  emp::Integer confirmed;
+  encountered.bits.resize(8 * sizeof(encounter::DeviceID));
+  // one fetch batch: the j-th encounter of each source (or sink) device
+  const size_t max_batch = std::max(source_count, sink_count);
+  std::vector<emp::Integer> fetched_encountered(max_batch);
+  std::vector<emp::Integer> fetched_previous(max_batch);
+  std::vector<emp::Integer> fetched_duration(max_batch);
+  std::vector<emp::Integer> fetched_confirmed(max_batch);
+  std::vector<emp::Integer> dummy_nonces(max_batch);
+  std::unique_ptr<emp::Bit[]> fetch_dummies(new emp::Bit[max_batch]);
   emp::Integer dummy_nonce;
   emp::Integer one_256_bits;
   emp::Integer device;
   emp::Integer start_time_integer;
-  BloomFilter<element_size, n_hashes> source_filter = BloomFilter<element_size, n_hashes>(source_count);
-  BloomFilter<element_size, n_hashes> sink_filter = BloomFilter<element_size, n_hashes>(sink_count);
-  BloomFilter<element_size, n_hashes> encountered_filter = BloomFilter<element_size, n_hashes>(encountered_filter_n_elements);
-  BloomFilter<element_size, n_hashes> already_infected_filter =
-    BloomFilter<element_size, n_hashes>((already_infected_filter_n_elements == 0) ? sink_count : already_infected_filter_n_elements);
+  // the filters are only used by the walk: SORT_JOIN does not build them
+  typedef BloomFilter<element_size, n_hashes> Filter;
+  std::unique_ptr<Filter> source_filter;
+  std::unique_ptr<Filter> sink_filter;
+  std::unique_ptr<Filter> encountered_filter;
+  std::unique_ptr<Filter> already_infected_filter;
   const emp::Integer one_32_bits = emp::Integer(32, (int32_t) 1, emp::PUBLIC);
-  emp::Bit fetch_dummy;
   emp::Bit is_source_bit;
   emp::Bit in_time_range;
   emp::Bit add_to_already_infected;
@@ -85,33 +167,42 @@ bool flow(ShuffleStore * shuffle_store,
   device.bits.resize(256);
   one_256_bits.bits.resize(256);
   one_256_bits.bits[0] = emp::Bit(true, emp::PUBLIC);
-  std::cout << revealer->preamble() << "preparing to initialize bloom filters" << std::endl << std::flush;
-  revealer->get_io()->sync();
-  std::cout << revealer->preamble() << "sync() complete" << std::endl << std::flush;
-  source_filter.initialize();
-  sink_filter.initialize();
-  encountered_filter.initialize();
-  std::cout << revealer->preamble() << "initialized bloom filters" << std::endl << std::flush;
-  revealer->get_io()->sync();
-  std::cout << revealer->preamble() << "sync() complete" << std::endl << std::flush;
+  if (strategy == WalkStrategy::BLOOM_FILTER) {
+    std::cout << revealer->preamble() << "preparing to initialize bloom filters" << std::endl << std::flush;
+    debug_sync(revealer->get_io());
+    source_filter = std::make_unique<Filter>(source_count);
+    sink_filter = std::make_unique<Filter>(sink_count);
+    encountered_filter = std::make_unique<Filter>(encountered_filter_n_elements);
+    already_infected_filter = std::make_unique<Filter>(
+        (already_infected_filter_n_elements == 0) ? sink_count : already_infected_filter_n_elements);
+    source_filter->initialize();
+    sink_filter->initialize();
+    encountered_filter->initialize();
+    std::cout << revealer->preamble() << "initialized bloom filters" << std::endl << std::flush;
+    debug_sync(revealer->get_io());
+  }
   for (size_t i = 1; i < 256; ++i) {
     one_256_bits.bits[i] = emp::Bit(false, emp::PUBLIC);
   }
   std::cout << revealer->preamble() << "preparing insert source ids" << std::endl << std::flush;
   for (size_t i = 0; i < source_count; ++i) {
     source_previous[i] = source_timestamps[i];
-    source_filter.insert(source_device_ids[i]);
+  }
+  if (strategy == WalkStrategy::BLOOM_FILTER) {
+    source_filter->insert_batch(source_device_ids, source_count);
     if (include_direct_source_to_sink_edges) {
-      encountered_filter.insert(source_device_ids[i]);
-      revealer->get_io()->sync();
+      encountered_filter->insert_batch(source_device_ids, source_count);
+      debug_sync(revealer->get_io());
     }
   }
   std::cout << revealer->preamble() << "inserted source ids" << std::endl << std::flush;
   std::cout << revealer->preamble() << "preparing insert sink ids" << std::endl << std::flush;
   for (size_t i = 0; i < sink_count; ++i) {
     sink_previous[i] = sink_timestamps[i];
-    sink_filter.insert(sink_device_ids[i]);
-    revealer->get_io()->sync();
+  }
+  if (strategy == WalkStrategy::BLOOM_FILTER) {
+    sink_filter->insert_batch(sink_device_ids, sink_count);
+    debug_sync(revealer->get_io());
   }
   std::cout << revealer->preamble() << "inserted sink ids" << std::endl << std::flush;
   if (debug_printouts) {
@@ -121,101 +212,105 @@ bool flow(ShuffleStore * shuffle_store,
   std::cout << "initialization_time: " << initialization_time << std::endl;
   total_fetch_time = time_now_millis();
   size_t index = 0;
+  size_t batch = 0;
   encounter::Timestamp revealstamp;
   for (bool is_source : {true, false}) {
     for (size_t s = 0; s < shuffle_count; ++s) {
       dummy_nonce = emp::Integer(256, &(dummy_start_nonces[s]));
-      //if (debug_printouts) { // print out our dummy nonce
-        uint8_t revealed_dummy_nonce[32];
-        revealer->get_io()->sync();
+      if (debug_printouts) { // print out our dummy nonce
+        uint8_t revealed_dummy_nonce[32] = {0};
+        debug_sync(revealer->get_io());
         //dummy_nonce.reveal(&(revealed_dummy_nonce[0]), emp::PUBLIC);
-        revealer->get_io()->sync();
+        debug_sync(revealer->get_io());
         std::cout << revealer->preamble() << "dummy_nonce: ";
         for (size_t x = 0; x < 32; ++x) {
           std::cout << std::setfill('0') << std::setw(2) << std::hex  << ((int) revealed_dummy_nonce[x]);
         }
         std::cout << std::dec << std::endl << std::flush;
-      //}
+      }
       start_time_integer = emp::Integer(8 * (sizeof(encounter::Timestamp)), (int64_t) shuffle_start_times[s], emp::PUBLIC);
-      for (size_t i = 0; i < (is_source ? source_count : sink_count); ++i) {
-        for (size_t j = 0; j < encounters_per_device_per_shuffle; ++j) {
-          fetch_times[index] = time_now_millis();
+      const size_t device_count = (is_source ? source_count : sink_count);
+      const emp::Integer * device_ids = (is_source ? source_device_ids : sink_device_ids);
+      emp::Integer * device_previous = (is_source ? source_previous : sink_previous);
+      // the j-th fetches of all the devices are independent: fetch them as one batch
+      for (size_t j = 0; j < encounters_per_device_per_shuffle; ++j) {
+        fetch_times[batch] = time_now_millis();
+        for (size_t i = 0; i < device_count; ++i) {
           // if this user's previous entry is too early for this shuffle, fetch a dummy.
-          fetch_dummy = (start_time_integer.geq((is_source ? source_previous : sink_previous)[i]));
+          fetch_dummies[i] = (start_time_integer.geq(device_previous[i]));
+          // each dummy fetched gets the next dummy_nonce
+          dummy_nonces[i] = dummy_nonce;
+          dummy_nonce = emp::If(fetch_dummies[i], dummy_nonce + one_256_bits, dummy_nonce);
           if (debug_printouts) {
             std::cout << "fetch s = " << s << "\ti = " << i << "\tj = " << j << std::endl << std::flush;
-          }
-          if (debug_printouts) {
             start_time_integer.reveal(&revealstamp, emp::PUBLIC);
             std::cout << "shuffle_start_time " << *((int32_t *) &revealstamp) << std::endl << std::flush;
-          }
-          if (debug_printouts) {
-            (is_source ? source_previous : sink_previous)[i].reveal(&revealstamp, emp::PUBLIC);
+            device_previous[i].reveal(&revealstamp, emp::PUBLIC);
             std::cout << "previous " << revealstamp << std::endl << std::flush;
-            std::cout << "it's a dummy: " << fetch_dummy.reveal(emp::PUBLIC) << std::endl << std::flush;
-          }
-          //if (debug_printouts) { // print out our dummy nonce
-            uint8_t revealed_dummy_nonce[32];
-            revealer->get_io()->sync();
-            //dummy_nonce.reveal(&(revealed_dummy_nonce[0]), emp::PUBLIC);
-            revealer->get_io()->sync();
-            std::cout << revealer->preamble() << "dummy_nonce: ";
-            for (size_t x = 0; x < 32; ++x) {
-              std::cout << std::setfill('0') << std::setw(2) << std::hex  << ((int) revealed_dummy_nonce[x]);
-            }
-            std::cout << std::dec << std::endl << std::flush;
-          //}
-          if (!fetch_and_decrypt_encounter(shuffle_store,
-                                           revealer,
-                                           shuffles[s],
-                                           &((is_source ? source_device_ids : sink_device_ids)[i]),
-                                           &((is_source ? source_previous : sink_previous)[i]),
-                                           &encountered,
-                                           &previous,
-                                           &duration,
-                                           &confirmed,
-                                           side,
-                                           storing_side,
-                                           &dummy_nonce,
-                                           &fetch_dummy)) {
-            std::cerr << "failed to fetch encounter from shuffle_store.\n" << std::flush;
-            return false;
+            std::cout << "it's a dummy: " << fetch_dummies[i].reveal(emp::PUBLIC) << std::endl << std::flush;
           }
-          if (debug_printouts) {
-            std::cout << "fetch s = " << s << "\ti = " << i << "\tj = " << j << " complete.\n" << std::flush;
-          }
-          encounter_list[index].bits.resize(encountered.size() +
-                                            (is_source ? source_device_ids : sink_device_ids)[i].size() +
-                                            1);
-          for (size_t k = 0; k < encountered.size(); ++k) {
-            encounter_list[index].bits[k].bit = encountered.bits[k].bit;
+        }
+        if (!fetch_and_decrypt_encounters(shuffle_store,
+                                          revealer,
+                                          shuffles[s],
+                                          device_ids,
+                                          device_previous,
+                                          device_count,
+                                          fetched_encountered.data(),
+                                          fetched_previous.data(),
+                                          fetched_duration.data(),
+                                          fetched_confirmed.data(),
+                                          side,
+                                          storing_side,
+                                          dummy_nonces.data(),
+                                          fetch_dummies.get())) {
+          std::cerr << "failed to fetch encounters from shuffle_store.\n" << std::flush;
+          return false;
+        }
+        if (debug_printouts) {
+          std::cout << "fetch s = " << s << "\tj = " << j << " complete.\n" << std::flush;
+        }
+        for (size_t i = 0; i < device_count; ++i) {
+          encounter_list[index].bits.resize(fetched_encountered[i].size() + device_ids[i].size() + 1);
+          for (size_t k = 0; k < fetched_encountered[i].size(); ++k) {
+            encounter_list[index].bits[k].bit = fetched_encountered[i].bits[k].bit;
           }
-          for (size_t k = 0; k < (is_source ? source_device_ids : sink_device_ids)[i].size(); ++k) {
-            encounter_list[index].bits[encountered.size() + k].bit =
-              (is_source ? source_device_ids : sink_device_ids)[i].bits[k].bit;
+          for (size_t k = 0; k < device_ids[i].size(); ++k) {
+            encounter_list[index].bits[fetched_encountered[i].size() + k].bit = device_ids[i].bits[k].bit;
           }
-          encounter_list[index].bits[encountered.size() +
-                                     (is_source ? source_device_ids : sink_device_ids)[i].size()] =
-                    emp::Bit(is_source, emp::PUBLIC);
+          encounter_list[index].bits[fetched_encountered[i].size() + device_ids[i].size()] = emp::Bit(is_source, emp::PUBLIC);
           // if we didn't fetch a dummy, and the encounter is of sufficient duration and confirmed, then store this element under the relevent time, but otherwise, use a high time so it goes to the end of the list. 
           encounter_list_times[index] = emp::If(
-              (!fetch_dummy) & (!(minimum_duration->geq(duration))) & (confirmed[0]),
-              (is_source ? source_previous : sink_previous)[i],
+              (!fetch_dummies[i]) & (!(minimum_duration->geq(fetched_duration[i]))) & (fetched_confirmed[i][0]),
+              device_previous[i],
               *sink_end_time);
           // update this user's previous entry if we didn't fetch a dummy.
-          (is_source ? source_previous : sink_previous)[i] = emp::If(fetch_dummy, (is_source ? source_previous : sink_previous)[i], previous);
-          
-          // if we fetched a dummy, then increment dummy_nonce
-          dummy_nonce = emp::If(fetch_dummy, dummy_nonce + one_256_bits, dummy_nonce);
-          fetch_times[index] = time_now_millis() - fetch_times[index];
-          std::cout << "fetch_times[" << index << "] = " << fetch_times[index] << std::endl;
+          device_previous[i] = emp::If(fetch_dummies[i], device_previous[i], fetched_previous[i]);
           ++index;
         }
+        fetch_times[batch] = time_now_millis() - fetch_times[batch];
+        std::cout << "fetch_times[" << batch << "] = " << fetch_times[batch] << std::endl;
+        ++batch;
       }
     }
   }
   total_fetch_time = time_now_millis() - total_fetch_time;
   std::cout << "total_fetch_time = " << total_fetch_time << std::endl;
+
+  if (strategy == WalkStrategy::SORT_JOIN) {
+    uint64_t join_time = time_now_millis();
+    (*output_count) = flow_sort_join(encounter_list, encounter_list_times, encounter_list_size,
+                                     source_device_ids, source_count, sink_device_ids, sink_count,
+                                     source_start_time, sink_end_time, include_direct_source_to_sink_edges);
+    join_time = time_now_millis() - join_time;
+    total_time = time_now_millis() - total_time;
+    std::cout << "total time: " << total_time << std::endl;
+    std::cout << "initialization_time = " << initialization_time << std::endl;
+    std::cout << "total_fetch_time = " << total_fetch_time << std::endl;
+    std::cout << "join_time = " << join_time << std::endl;
+    return true;
+  }
+
   sort_time = time_now_millis();
 
   if (debug_printouts) {
@@ -231,8 +326,6 @@ bool flow(ShuffleStore * shuffle_store,
   }
   total_walk_time = time_now_millis();
 
-  already_infected_filter.insert(one_256_bits); // we'll use this as a dummy value later
-
 
   for (size_t i = 0; i < encounters_to_walk_through; ++i) {
     walk_times[i] = time_now_millis();
@@ -257,17 +350,15 @@ bool flow(ShuffleStore * shuffle_store,
       //if its a source encounter and encoutnered is not in source_filter or sink_filter:
         // add encountered to filter
     if (include_direct_source_to_sink_edges) {
-      encountered_filter.insert(
-          emp::If(is_source_bit & in_time_range & (!(sink_filter.contains(encountered).bits[0])),
-                  encountered,
-                  one_256_bits)); // we're using one_256_bits as a dummy value here.
+      encountered_filter->insert(
+          encountered,
+          is_source_bit & in_time_range & (!(sink_filter->contains(encountered).bits[0])));
     } else {
-      encountered_filter.insert(
-          emp::If(is_source_bit & in_time_range &
-                     (!(source_filter.contains(encountered).bits[0])) &
-                     (!(sink_filter.contains(encountered).bits[0])),
-                  encountered,
-                  one_256_bits)); // we're using one_256_bits as a dummy value here.
+      encountered_filter->insert(
+          encountered,
+          is_source_bit & in_time_range &
+             (!(source_filter->contains(encountered).bits[0])) &
+             (!(sink_filter->contains(encountered).bits[0])));
     }
 
 
@@ -276,11 +367,9 @@ bool flow(ShuffleStore * shuffle_store,
         // if encountered is in filter:
           // add device to already_infected_filter
           // and increment output_count
+    add_to_already_infected = (!is_source_bit) & in_time_range & encountered_filter->contains(encountered).bits[0];
     (*output_count) = emp::If(
-        already_infected_filter.contains_and_insert(
-            emp::If((!is_source_bit) & in_time_range & encountered_filter.contains(encountered).bits[0],
-                    device,
-                    one_256_bits)).bits[0], // we're using one_256_bits as a dummy value here.
+        already_infected_filter->contains_and_insert(device, add_to_already_infected).bits[0] | (!add_to_already_infected),
         (*output_count),
         (*output_count) + one_32_bits);
     walk_times[i] = time_now_millis() - walk_times[i];
@@ -288,8 +377,8 @@ bool flow(ShuffleStore * shuffle_store,
   }
   total_walk_time = time_now_millis() - total_walk_time;
   total_time = time_now_millis() - total_time;
-  std::cout << "fetch_times[" << encounter_list_size << "] = ";
-  for (size_t i = 0; i < encounter_list_size; ++i) {
+  std::cout << "fetch_times[" << batch << "] = ";
+  for (size_t i = 0; i < batch; ++i) {
     std::cout << fetch_times[i] << ", ";
   }
   std::cout << std::endl << std::endl;
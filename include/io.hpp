@@ -8,10 +8,11 @@
 #include "include/types.h"
 
 void send_list_reverse(emp::NetIO& mrio, const emp::Integer* list,
-                       const size_t list_size) {
+                       const size_t list_size,
+                       const size_t width = entrybits) {
     // connect to reducer
     for (size_t i = 0; i < list_size; i++) {
-        for (size_t j = 0; j < hashbits; j++) {
+        for (size_t j = 0; j < width; j++) {
             mrio.send_block(&list[(list_size - 1) - i].bits[j].bit, 1);
             // std::cout << (party == emp::ALICE ? "(gen) " : "(eva) ")
             // << "Sent: " << i << ": " << j << std::endl;
@@ -20,11 +21,12 @@ void send_list_reverse(emp::NetIO& mrio, const emp::Integer* list,
 }
 
 void send_list_reverse(tcp::socket& socket, const emp::Integer* list,
-                       const size_t list_size) {
+                       const size_t list_size,
+                       const size_t width = entrybits) {
     // connect to reducer
     emp::block tmp;
     for (size_t i = 0; i < list_size; i++) {
-        for (size_t j = 0; j < hashbits; j++) {
+        for (size_t j = 0; j < width; j++) {
             tmp = list[(list_size - 1) - i].bits[j].bit;
             send_block(socket, tmp);
             // std::cout << (party == emp::ALICE ? "(gen) " : "(eva) ")
@@ -34,10 +36,11 @@ void send_list_reverse(tcp::socket& socket, const emp::Integer* list,
 }
 
 void send_list(emp::NetIO& mrio, const emp::Integer* list,
-               const size_t list_size) {
+               const size_t list_size,
+               const size_t width = entrybits) {
     // connect to reducer
     for (size_t i = 0; i < list_size; i++) {
-        for (size_t j = 0; j < hashbits; j++) {
+        for (size_t j = 0; j < width; j++) {
             mrio.send_block(&list[0].bits[j].bit, 1);
             // std::cout << (party == emp::ALICE ? "(gen) " : "(eva) ")
             // << "Sent: " << i << ": " << j << std::endl;
@@ -46,11 +49,12 @@ void send_list(emp::NetIO& mrio, const emp::Integer* list,
 }
 
 void receive_list(emp::NetIO& mrio, emp::Integer* list,
-                  const size_t list_size) {
+                  const size_t list_size,
+                  const size_t width = entrybits) {
     // start listening
-    emp::Integer tmp_int(hashbits, 0);
+    emp::Integer tmp_int(width, 0);
     for (size_t i = 0; i < list_size; i++) {
-        for (size_t j = 0; j < hashbits; j++) {
+        for (size_t j = 0; j < width; j++) {
             mrio.recv_block(&tmp_int.bits[j].bit, 1);
             // std::cout << (party == emp::ALICE ? "(gen) " : "(eva) ")
             // << "Got: " << i << ": " << j << std::endl;
@@ -61,11 +65,12 @@ void receive_list(emp::NetIO& mrio, emp::Integer* list,
 }
 
 void receive_list(tcp::socket& socket, emp::Integer* list,
-                  const size_t list_size) {
+                  const size_t list_size,
+                  const size_t width = entrybits) {
     // start listening
-    emp::Integer tmp_int(hashbits, 0);
+    emp::Integer tmp_int(width, 0);
     for (size_t i = 0; i < list_size; i++) {
-        for (size_t j = 0; j < hashbits; j++) {
+        for (size_t j = 0; j < width; j++) {
             tmp_int.bits[j].bit = read_block(socket);
             // std::cout << (party == emp::ALICE ? "(gen) " : "(eva) ")
             // << "Got: " << i << ": " << j << std::endl;
@@ -0,0 +1,286 @@
+// Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org>
+// Author: Roberta De Viti
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <emp-sh2pc/emp-sh2pc.h>
+#include <include/contact_path_query.hpp>
+#include <include/dualex_reveal.hpp>
+#include <include/encounter.hpp>
+#include <include/primitives.hpp>
+#include <include/secrets.hpp>
+#include <include/sort_join.hpp>
+#include <include/store_path_encounter.hpp>
+#include <immintrin.h>
+#include <algorithm>
+#include <vector>
+
+namespace pathquery {
+
+// the devices a k-hop query can reach, with their most recent known encounters (a device's history can only be walked
+// backwards from one of its own records). the ids should be distinct.
+struct KHopPopulation {
+  std::vector<emp::Integer> ids;
+  std::vector<emp::Integer> latest; // timestamp of the most recent known encounter
+  std::vector<emp::Integer> reach_time; // when the device was first reached (valid once reached)
+  std::vector<emp::Bit> reached;
+};
+
+// mark the population devices reached by valid candidate encounters (encountered, time), at the earliest such time.
+// returns the devices reached for the first time, and leaves the population sorted by id.
+// the population and the candidates are sorted once by (id, candidates first, time), so one pass carries the earliest
+// valid candidate of each id to its population entry; a compaction then pulls the population entries back out.
+std::vector<emp::Bit> khop_sort_join(KHopPopulation & population,
+                                     const std::vector<emp::Integer> & encountered,
+                                     const std::vector<emp::Integer> & times,
+                                     const std::vector<emp::Bit> & valid) {
+  const size_t id_bits = 8 * sizeof(encounter::DeviceID);
+  const size_t time_bits = 8 * sizeof(encounter::Timestamp);
+  const size_t population_count = population.ids.size();
+  const size_t size = population_count + encountered.size();
+  const emp::Bit zero(false, emp::PUBLIC);
+  std::vector<emp::Bit> newly(population_count, zero);
+  if (encountered.empty()) {
+    return newly;
+  }
+  // keys: [time][tag][id], tag 1 for the population (after the candidates of its id)
+  // payloads: [latest][reach_time][reached][valid]
+  const emp::Integer no_time(time_bits, 0, emp::PUBLIC);
+  const emp::Integer candidate_tag = bit_integer(zero);
+  const emp::Integer population_tag = bit_integer(emp::Bit(true, emp::PUBLIC));
+  std::vector<emp::Integer> keys(size);
+  std::vector<emp::Integer> payloads(size);
+  for (size_t p = 0; p < population_count; ++p) {
+    const emp::Integer reached = bit_integer(population.reached[p]);
+    keys[p] = concat({&no_time, &population_tag, &(population.ids[p])});
+    payloads[p] = concat({&(population.latest[p]), &(population.reach_time[p]), &reached, &candidate_tag});
+  }
+  for (size_t c = 0; c < encountered.size(); ++c) {
+    const emp::Integer is_valid = bit_integer(valid[c]);
+    keys[population_count + c] = concat({&(times[c]), &candidate_tag, &(encountered[c])});
+    payloads[population_count + c] = concat({&no_time, &no_time, &candidate_tag, &is_valid});
+  }
+  emp::sort(keys.data(), (int) size, payloads.data(), true);
+
+  const std::vector<emp::Bit> heads = id_heads(keys, time_bits + 1, id_bits);
+  std::vector<emp::Integer> entries(size);
+  emp::Bit found;
+  emp::Integer found_time;
+  for (size_t r = 0; r < size; ++r) {
+    const emp::Bit is_population = keys[r].bits[time_bits];
+    const emp::Integer time = sub_integer(keys[r], 0, time_bits);
+    const emp::Bit is_valid_candidate = (!is_population) & payloads[r].bits[2 * time_bits + 1];
+    if (r == 0) {
+      found = is_valid_candidate;
+      found_time = time;
+    } else {
+      // candidates come in time order: keep the first valid one of this id
+      const emp::Bit keep = (!heads[r]) & found;
+      found_time = emp::If(keep, found_time, time);
+      found = keep | is_valid_candidate;
+    }
+    const emp::Bit was_reached = payloads[r].bits[2 * time_bits];
+    const emp::Bit is_new = is_population & found & (!was_reached);
+    const emp::Integer id = sub_integer(keys[r], time_bits + 1, id_bits);
+    const emp::Integer latest = sub_integer(payloads[r], 0, time_bits);
+    const emp::Integer reach_time = emp::If(is_new, found_time, sub_integer(payloads[r], time_bits, time_bits));
+    const emp::Integer reached = bit_integer(was_reached | is_new);
+    const emp::Integer new_bit = bit_integer(is_new);
+    entries[r] = make_entry(concat({&id, &latest, &reach_time, &reached, &new_bit}), is_population);
+  }
+  // the population entries, in id order, to the front
+  compact_valid(entries);
+  for (size_t p = 0; p < population_count; ++p) {
+    population.ids[p] = sub_integer(entries[p], 0, id_bits);
+    population.latest[p] = sub_integer(entries[p], id_bits, time_bits);
+    population.reach_time[p] = sub_integer(entries[p], id_bits + time_bits, time_bits);
+    population.reached[p] = entries[p].bits[id_bits + 2 * time_bits];
+    newly[p] = entries[p].bits[id_bits + 2 * time_bits + 1];
+  }
+  return newly;
+}
+
+// k-hop contact tracing: count the population devices reachable from the sources through at most hops time-respecting
+// encounters (each hop at a time later than the hop before it, within (start_time, end_time)).
+// each round walks the histories of the frontier (the sources, then the devices reached in the previous round) in
+// fetch batches of at most batch_size devices, joins the encounters found with the population, and compacts the newly
+// reached devices into the next frontier, cut at the public frontier_bound.
+// if more devices than frontier_bound are reached in a round, the rest are counted but not expanded: frontier_overflow
+// (if given) reports whether that happened in any round.
+bool khop(ShuffleStore * shuffle_store,
+          dualex::Revealer * revealer,
+          const emp::Integer * start_time,
+          const emp::Integer * end_time,
+          const emp::Integer * minimum_duration,
+          const emp::Integer source_device_ids[], // encodes list of most recent known encounters
+          const emp::Integer source_timestamps[],
+          const size_t source_count,
+          const emp::Integer population_device_ids[], // encodes list of most recent known encounters
+          const emp::Integer population_timestamps[],
+          const size_t population_count,
+          const ShuffleID shuffles[],
+          const encounter::Timestamp shuffle_start_times[],
+          const __m256i dummy_start_nonces[],
+          const size_t shuffle_count,
+          const size_t hops,
+          const size_t frontier_bound,
+          emp::Integer * output_count,
+          const secrets::Side side,
+          const secrets::Side storing_side = secrets::RIGHT,
+          const size_t encounters_per_device_per_shuffle = 300,
+          const size_t batch_size = 0, // 0 fetches the whole frontier as one batch.
+          emp::Integer hop_counts[] = nullptr, // if given, the number of devices first reached in each hop.
+          emp::Bit * frontier_overflow = nullptr,
+          const bool debug_printouts = false
+         ) {
+  const size_t time_bits = 8 * sizeof(encounter::Timestamp);
+  const size_t id_bits = 8 * sizeof(encounter::DeviceID);
+  const emp::Integer one_32_bits = emp::Integer(32, (int32_t) 1, emp::PUBLIC);
+  const emp::Integer zero_32_bits = emp::Integer(32, (int32_t) 0, emp::PUBLIC);
+  const emp::Integer bound_integer = emp::Integer(32, (int64_t) frontier_bound, emp::PUBLIC);
+  emp::Integer one_256_bits;
+  uint64_t total_time = time_now_millis();
+  uint64_t fetch_time;
+  uint64_t join_time;
+
+  (*output_count) = zero_32_bits;
+  if (frontier_overflow != nullptr) {
+    (*frontier_overflow) = emp::Bit(false, emp::PUBLIC);
+  }
+  one_256_bits.bits.resize(256);
+  one_256_bits.bits[0] = emp::Bit(true, emp::PUBLIC);
+  for (size_t i = 1; i < 256; ++i) {
+    one_256_bits.bits[i] = emp::Bit(false, emp::PUBLIC);
+  }
+  // each shuffle's dummies continue across rounds, so no dummy is fetched twice
+  std::vector<emp::Integer> dummy_nonce(shuffle_count);
+  for (size_t s = 0; s < shuffle_count; ++s) {
+    dummy_nonce[s] = emp::Integer(256, &(dummy_start_nonces[s]));
+  }
+
+  KHopPopulation population;
+  population.ids.assign(population_device_ids, population_device_ids + population_count);
+  population.latest.assign(population_timestamps, population_timestamps + population_count);
+  population.reach_time.assign(population_count, *start_time);
+  population.reached.assign(population_count, emp::Bit(false, emp::PUBLIC));
+
+  // the first frontier is the sources, reached at start_time: mark them reached in the population
+  std::vector<emp::Integer> frontier_ids(source_device_ids, source_device_ids + source_count);
+  std::vector<emp::Integer> frontier_latest(source_timestamps, source_timestamps + source_count);
+  std::vector<emp::Integer> frontier_reach_time(source_count, *start_time);
+  std::vector<emp::Bit> frontier_valid(source_count, emp::Bit(true, emp::PUBLIC));
+  khop_sort_join(population, frontier_ids, frontier_reach_time, frontier_valid);
+
+  for (size_t hop = 0; hop < hops; ++hop) {
+    const size_t frontier_count = frontier_ids.size();
+    const size_t batch = (batch_size == 0 || batch_size > frontier_count) ? frontier_count : batch_size;
+    std::vector<emp::Integer> walk_previous(frontier_latest);
+    std::vector<emp::Integer> fetched_encountered(batch);
+    std::vector<emp::Integer> fetched_previous(batch);
+    std::vector<emp::Integer> fetched_duration(batch);
+    std::vector<emp::Integer> fetched_confirmed(batch);
+    std::vector<emp::Integer> dummy_nonces(batch);
+    std::unique_ptr<emp::Bit[]> fetch_dummies(new emp::Bit[batch]);
+    std::vector<emp::Integer> candidate_encountered;
+    std::vector<emp::Integer> candidate_times;
+    std::vector<emp::Bit> candidate_valid;
+    candidate_encountered.reserve(frontier_count * shuffle_count * encounters_per_device_per_shuffle);
+    candidate_times.reserve(candidate_encountered.capacity());
+    candidate_valid.reserve(candidate_encountered.capacity());
+
+    fetch_time = time_now_millis();
+    for (size_t s = 0; s < shuffle_count && frontier_count > 0; ++s) {
+      const emp::Integer start_time_integer = emp::Integer(time_bits, (int64_t) shuffle_start_times[s], emp::PUBLIC);
+      for (size_t j = 0; j < encounters_per_device_per_shuffle; ++j) {
+        for (size_t first = 0; first < frontier_count; first += batch) {
+          const size_t count = std::min(batch, frontier_count - first);
+          for (size_t i = 0; i < count; ++i) {
+            // fetch a dummy for an empty frontier slot, or if this device's previous entry is too early for this shuffle
+            fetch_dummies[i] = (!frontier_valid[first + i]) | start_time_integer.geq(walk_previous[first + i]);
+            dummy_nonces[i] = dummy_nonce[s];
+            dummy_nonce[s] = emp::If(fetch_dummies[i], dummy_nonce[s] + one_256_bits, dummy_nonce[s]);
+          }
+          if (!fetch_and_decrypt_encounters(shuffle_store,
+                                            revealer,
+                                            shuffles[s],
+                                            &(frontier_ids[first]),
+                                            &(walk_previous[first]),
+                                            count,
+                                            fetched_encountered.data(),
+                                            fetched_previous.data(),
+                                            fetched_duration.data(),
+                                            fetched_confirmed.data(),
+                                            side,
+                                            storing_side,
+                                            dummy_nonces.data(),
+                                            fetch_dummies.get())) {
+            std::cerr << "failed to fetch encounters from shuffle_store.\n" << std::flush;
+            return false;
+          }
+          for (size_t i = 0; i < count; ++i) {
+            emp::Integer & previous = walk_previous[first + i];
+            // time-respecting: only encounters after this device was reached carry the hop on
+            const emp::Bit valid = (!fetch_dummies[i]) & fetched_confirmed[i][0] &
+              (!(minimum_duration->geq(fetched_duration[i]))) &
+              (frontier_reach_time[first + i] < previous) & (previous < *end_time);
+            candidate_encountered.push_back(fetched_encountered[i]);
+            candidate_times.push_back(previous);
+            candidate_valid.push_back(valid);
+            previous = emp::If(fetch_dummies[i], previous, fetched_previous[i]);
+          }
+        }
+        if (debug_printouts) {
+          std::cout << revealer->preamble() << "hop = " << hop << "\ts = " << s << "\tj = " << j << " fetched.\n" << std::flush;
+        }
+      }
+    }
+    fetch_time = time_now_millis() - fetch_time;
+
+    join_time = time_now_millis();
+    const std::vector<emp::Bit> newly = khop_sort_join(population, candidate_encountered, candidate_times, candidate_valid);
+    emp::Integer newly_count = zero_32_bits;
+    for (size_t p = 0; p < population_count; ++p) {
+      newly_count = emp::If(newly[p], newly_count + one_32_bits, newly_count);
+    }
+    (*output_count) = (*output_count) + newly_count;
+    if (hop_counts != nullptr) {
+      hop_counts[hop] = newly_count;
+    }
+
+    // the next frontier: the newly reached devices, compacted to the front and cut at frontier_bound
+    if (hop + 1 < hops) {
+      if (frontier_overflow != nullptr) {
+        (*frontier_overflow) = (*frontier_overflow) | (bound_integer < newly_count);
+      }
+      std::vector<emp::Integer> entries(population_count);
+      for (size_t p = 0; p < population_count; ++p) {
+        entries[p] = make_entry(concat({&(population.ids[p]), &(population.latest[p]), &(population.reach_time[p])}),
+                                newly[p]);
+      }
+      compact_valid(entries);
+      const size_t next_count = std::min(frontier_bound, population_count);
+      frontier_ids.resize(next_count);
+      frontier_latest.resize(next_count);
+      frontier_reach_time.resize(next_count);
+      frontier_valid.resize(next_count);
+      for (size_t f = 0; f < next_count; ++f) {
+        frontier_ids[f] = sub_integer(entries[f], 0, id_bits);
+        frontier_latest[f] = sub_integer(entries[f], id_bits, time_bits);
+        frontier_reach_time[f] = sub_integer(entries[f], id_bits + time_bits, time_bits);
+        frontier_valid[f] = valid_bit(entries[f]);
+      }
+    }
+    join_time = time_now_millis() - join_time;
+    if (debug_printouts) {
+      std::cout << revealer->preamble() << "hop " << hop << ": frontier = " << frontier_count
+                << ", candidates = " << candidate_valid.size() << ", fetch_time = " << fetch_time
+                << ", join_time = " << join_time << std::endl;
+    }
+  }
+  total_time = time_now_millis() - total_time;
+  if (debug_printouts) {
+    std::cout << revealer->preamble() << "total_time = " << total_time << std::endl;
+  }
+  return true;
+}
+}
@@ -33,14 +33,13 @@ emp::Integer hmacShaXIntegers(const uint16_t SHA, const emp::Integer integer[],
                               int count) {
     size_t block_size, output_size;
     emp::block blocks[1];
-    BristolFormat cf("circuits/bristol_format/sha-256.txt");
+    BristolFormat cf =
+        circuits::load(SHA == 1 ? circuits::sha_1 : circuits::sha_256);
 
     if (SHA == 256) {
         block_size = BLOCK_SIZE_SHA_256;
         output_size = OUTPUT_SIZE_SHA_256;
-        BristolFormat cf("circuits/bristol_format/sha-256.txt");
     } else if (SHA == 1) {
-        BristolFormat cf("circuits/bristol_format/sha-1.txt");
         block_size = BLOCK_SIZE_SHA_1;
         output_size = OUTPUT_SIZE_SHA_1;
     } else {
@@ -123,7 +122,7 @@ emp::Integer hmacSha256Integers(const emp::Integer integer[], FieldName field,
     emp::Integer m = emp::Integer(BLOCK_SIZE_SHA_256, 0);
     emp::Integer hash(OUTPUT_SIZE_SHA_256, 0);
     emp::block blocks[1];
-    BristolFormat cf("circuits/bristol_format/sha-256.txt");
+    BristolFormat cf = circuits::load(circuits::sha_256);
 
     for (int k = 0; k < count; k++) {
         switch (field) {
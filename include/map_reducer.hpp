@@ -7,13 +7,25 @@
 #include "include/mapper_macs.hpp"
 #include "include/reducer.hpp"
 #include "include/macs/kmac.hpp"
+#include "include/parallel_sort.hpp"
+
+// sort the pair of tiles descending, across the sessions of pool if given
+void sort_pair(std::vector<emp::Integer>& lists, const size_t size,
+               parallel::SessionPool* pool) {
+    if (pool != nullptr) {
+        parallel::sort(*pool, &lists[0], size, (Bit*)nullptr, false);
+    } else {
+        emp::sort(&lists[0], size, (Bit*)nullptr, false);
+    }
+}
 
 // process first pair of tiles, run in microbenchmarks
 std::vector<emp::Integer> process_first_pair(Redis& redis,
                                              const std::string key,
                                              const size_t tile_size,
                                              const emp::Integer sick,
-                                             const int party) {
+                                             const int party,
+                                             parallel::SessionPool* pool = nullptr) {
     std::vector<emp::Integer> lists;
     lists.reserve(2 * tile_size);
     run_query_unique_devices(redis, key, lists, tile_size, sick, party);
@@ -23,7 +35,7 @@ std::vector<emp::Integer> process_first_pair(Redis& redis,
     //    lists[j].reveal<int>() << std::endl;
     //}
     // sort the tiles
-    emp::sort(&lists[0], 2 * tile_size, (Bit*)nullptr, false);
+    sort_pair(lists, 2 * tile_size, pool);
     // for (size_t j = 0; j < lists.size(); j++) {
     //    std::cout << "Merged Element (total " << lists.size() << ") " << j <<
     //    ": " << lists[j].reveal<int>() << std::endl;
@@ -45,7 +57,8 @@ std::vector<emp::Integer> process_first_pair_nogv(Redis& redis,
                                              const std::string key,
                                              const size_t tile_size,
                                              const emp::Integer sick,
-                                             const int party, emp::Integer* mac_key) {
+                                             const int party, emp::Integer* mac_key,
+                                             parallel::SessionPool* pool = nullptr) {
     std::vector<emp::Integer> lists;
     lists.reserve(2 * tile_size);
     run_query_unique_devices_nogv(redis, key, lists, tile_size, sick, mac_key, party);
@@ -55,7 +68,7 @@ std::vector<emp::Integer> process_first_pair_nogv(Redis& redis,
     //    lists[j].reveal<int>() << std::endl;
     //}
     // sort the tiles
-    emp::sort(&lists[0], 2 * tile_size, (Bit*)nullptr, false);
+    sort_pair(lists, 2 * tile_size, pool);
     // for (size_t j = 0; j < lists.size(); j++) {
     //    std::cout << "Merged Element (total " << lists.size() << ") " << j <<
     //    ": " << lists[j].reveal<int>() << std::endl;
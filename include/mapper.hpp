@@ -6,6 +6,7 @@
 #include <emp-sh2pc/emp-sh2pc.h>
 #include <emp-tool/emp-tool.h>
 #include <emp-tool/utils/prg.h>
+#include "include/primitives.hpp"
 #include "include/types.h"
 #include <sys/wait.h>
 #include <iostream>
@@ -44,9 +45,7 @@ void run_query_unique_devices(Redis& redis, std::string key,
                               std::vector<emp::Integer>& tile, size_t tile_size,
                               emp::Integer sick, int party,
                               bool in_place = false, int start_idx = 0) {
-    // represent none value as maximum positive value on 32-bit
-    // so that a sort will put it at the end
-    const emp::Integer none(hashbits, -2147483648, emp::PUBLIC);
+    // non-contacts are entries with the valid bit unset
     const emp::Bit confirmed(1, emp::PUBLIC);
 
     auto redis_value = redis.get(key);
@@ -91,14 +90,14 @@ void run_query_unique_devices(Redis& redis, std::string key,
         if (!in_place) {
             // reconstruct did and match with sick did, constructing list
             tile.emplace_back(
-                emp::If((did_1 == sick) & (conf.bits[0] == confirmed),
-                        (did_2).resize(hashbits), none));
+                make_entry((did_2).resize(hashbits),
+                           (did_1 == sick) & (conf.bits[0] == confirmed)));
             // std::cout << (party == emp::ALICE ? "(gen) " : "(eva) ") <<
             // did_1.reveal<unsigned long>() << std::endl;
         } else {
             tile[start_idx] =
-                emp::If((did_1 == sick) & (conf.bits[0] == confirmed),
-                        (did_2).resize(hashbits), none);
+                make_entry((did_2).resize(hashbits),
+                           (did_1 == sick) & (conf.bits[0] == confirmed));
             start_idx = start_idx + 1;
         }
     }
@@ -178,9 +177,7 @@ std::tuple<double, double> run_query_nogv(Redis& redis, std::string key,
                                      std::vector<emp::Integer>& tile,
                                      size_t tile_size, emp::Integer sick,
                                      int party, void* p_io) {
-    // represent none value as maximum positive value on 32-bit
-    // so that a sort will put it at the end
-    const emp::Integer none(hashbits, -2147483648, emp::PUBLIC);
+    // non-contacts are entries with the valid bit unset
     const emp::Integer confirmed(8, 1, emp::PUBLIC);
 
     std::unique_ptr<emp::NetIO, std::default_delete<emp::NetIO>>* io =
@@ -215,9 +212,9 @@ std::tuple<double, double> run_query_nogv(Redis& redis, std::string key,
         emp::Integer conf_b =
             Integer(8, redis_value.data() + offset + skip, emp::BOB);
         // reconstruct did and match with sick did, constructing list
-        tile.emplace_back(emp::If(
-            ((did_1a ^ did_1b) == sick) & ((conf_a ^ conf_b) == confirmed),
-            (did_2a ^ did_2b).resize(hashbits), none));
+        tile.emplace_back(make_entry(
+            (did_2a ^ did_2b).resize(hashbits),
+            ((did_1a ^ did_1b) == sick) & ((conf_a ^ conf_b) == confirmed)));
         // std::cout << (party == emp::ALICE ? "(gen) " : "(eva) ") <<
         // did_1a.reveal<unsigned long>() << std::endl;
         // std::cout << (party == emp::ALICE ? "(gen) " : "(eva) ") <<
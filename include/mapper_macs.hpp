@@ -5,6 +5,7 @@
 #include <emp-sh2pc/emp-sh2pc.h>
 #include <emp-tool/emp-tool.h>
 #include <emp-tool/utils/prg.h>
+#include "include/primitives.hpp"
 #include "include/types.h"
 #include <sys/wait.h>
 #include <iostream>
@@ -17,9 +18,7 @@ void run_query_unique_devices_nogv(Redis& redis, std::string key,
                                      std::vector<emp::Integer>& tile,
                                      size_t tile_size, emp::Integer sick, emp::Integer* mac_key,
                                      int party, bool in_place = false, int start_idx = 0) {
-    // represent none value as maximum positive value on 32-bit
-    // so that a sort will put it at the end
-    const emp::Integer none(hashbits, -2147483648, emp::PUBLIC);
+    // non-contacts are entries with the valid bit unset
     const emp::Integer confirmed(8, 1, emp::PUBLIC);
 
     auto redis_value = redis.get(key);
@@ -78,16 +77,16 @@ void run_query_unique_devices_nogv(Redis& redis, std::string key,
     for (size_t i = 0; i < tile_size; i++) {
        // reconstruct did and match with sick did, constructing list
 	if (!in_place) {
-        	tile.emplace_back(emp::If(((did_1[i] == sick) & (conf[i] == confirmed)), 
-					(did_2[i]).resize(hashbits), none));
+        	tile.emplace_back(make_entry((did_2[i]).resize(hashbits),
+					(did_1[i] == sick) & (conf[i] == confirmed)));
         	// std::cout << (party == emp::ALICE ? "(gen) " : "(eva) ") <<
         	// did_1[i].reveal<unsigned long>() << std::endl;
         	// std::cout << (party == emp::ALICE ? "(gen) " : "(eva) ") <<
         	// did_2[i].reveal<unsigned long>() << std::endl;
     	} else {
 		tile[start_idx] =
-        		emp::If(((did_1[i] == sick) & (conf[i] == confirmed)),
-            		(did_2[i]).resize(hashbits), none);
+        		make_entry((did_2[i]).resize(hashbits),
+            		(did_1[i] == sick) & (conf[i] == confirmed));
 		start_idx = start_idx + 1;
 	}
     }
@@ -0,0 +1,233 @@
+// Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org>
+// Author: Roberta De Viti
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <emp-sh2pc/emp-sh2pc.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Parallel execution of bitonic networks across several concurrent 2PC
+// sessions.
+// All the compare-exchanges within a stage of a bitonic network are
+// independent, so each stage is split across T workers: worker 0 is the
+// calling thread (with the session set up by the caller), workers 1..T-1
+// are threads, each with its own NetIO and its own circuit and protocol
+// execution. This requires emp-tool and CoVault to be built with THREADING,
+// so that circ_exec and prot_exec are thread-local.
+// Wire labels are shared in RAM at stage boundaries: this works because all
+// the generator sessions garble with the same global delta (see
+// third_party/emp_custom/halfgate_gen.h), so a label produced in one session
+// is a valid input label in any other.
+namespace parallel {
+
+// Ports. The benchmarks (bench/generate_*_bench.py) keep all their other
+// ports from 50000 up: 2PC sessions on 50000.. and 55000.. (reducer_eq on
+// port, port + 1 and port + 1000), reduction tree nodes on 51000 + node,
+// mapper to reducer links on 50100.., 50500, 55100.., 55500, 60000 + leaf
+// and 65000, reduction tree edges on 61000 + fan_in * node + k.
+// The session pools take a range of their own below these: the pool of
+// session s (a node of a reduction tree, a round of reducer_eq, ...) with
+// n_workers workers takes pool_port(s, n_workers) + w for w = 1 .. n_workers-1,
+// so the sessions of a deployment must all run the same n_workers.
+static const int POOL_BASE_PORT = 40000;
+static const int POOL_END_PORT = 50000;
+
+inline int pool_port(int session, size_t n_workers) {
+    const int base = POOL_BASE_PORT + session * (int)n_workers;
+    if (session < 0 || base + (int)n_workers > POOL_END_PORT) {
+        std::cerr << "pool_port: session " << session << " with " << n_workers
+                  << " workers does not fit in ports " << POOL_BASE_PORT
+                  << ".." << POOL_END_PORT << std::endl;
+        exit(1);
+    }
+    return base;
+}
+
+class SessionPool {
+   private:
+    std::vector<std::thread> threads;
+    std::mutex m;
+    std::condition_variable cv_start;
+    std::condition_variable cv_done;
+    std::function<void(size_t)> task;
+    uint64_t generation = 0;
+    size_t pending = 0;
+    bool stopping = false;
+
+    void worker_loop(size_t w, int party, std::string peer_ip, int port,
+                     bool malicious) {
+        // per-thread session, set up before accepting any task
+        auto io = std::make_unique<emp::NetIO>(
+            party == emp::ALICE ? nullptr : peer_ip.c_str(), port, true);
+        emp::setup_semi_honest(io.get(), party, malicious);
+        uint64_t seen = 0;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            if (--pending == 0) cv_done.notify_one();
+        }
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv_start.wait(lock,
+                              [&] { return stopping || generation != seen; });
+                if (stopping) break;
+                seen = generation;
+            }
+            task(w);
+            io->flush();
+            {
+                std::unique_lock<std::mutex> lock(m);
+                if (--pending == 0) cv_done.notify_one();
+            }
+        }
+        emp::finalize_semi_honest();
+    }
+
+   public:
+    // worker w > 0 connects to peer_ip on base_port + w (generator listens)
+    SessionPool(int party, const std::string& peer_ip, int base_port,
+                size_t n_workers = 1, bool malicious = true) {
+#ifndef THREADING
+        if (n_workers > 1) {
+            std::cerr << "SessionPool: built without THREADING, running on "
+                         "1 worker instead of "
+                      << n_workers << std::endl;
+            n_workers = 1;
+        }
+#endif
+        pending = n_workers - 1;
+        for (size_t w = 1; w < n_workers; w++) {
+            threads.emplace_back(&SessionPool::worker_loop, this, w, party,
+                                 peer_ip, base_port + (int)w, malicious);
+        }
+        // wait until all the sessions are up
+        std::unique_lock<std::mutex> lock(m);
+        cv_done.wait(lock, [&] { return pending == 0; });
+    }
+
+    ~SessionPool() {
+        {
+            std::unique_lock<std::mutex> lock(m);
+            stopping = true;
+        }
+        cv_start.notify_all();
+        for (auto& t : threads) t.join();
+    }
+
+    size_t size() const { return threads.size() + 1; }
+
+    // run f(w) on every worker w (worker 0 is the calling thread)
+    // and return when all of them are done
+    void run(const std::function<void(size_t)>& f) {
+        if (threads.empty()) {
+            f(0);
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> lock(m);
+            task = f;
+            pending = threads.size();
+            generation++;
+        }
+        cv_start.notify_all();
+        f(0);
+        std::unique_lock<std::mutex> lock(m);
+        cv_done.wait(lock, [&] { return pending == 0; });
+    }
+};
+
+struct CompareExchange {
+    size_t i;
+    size_t j;
+    bool acc;
+};
+
+// split one stage of independent compare-exchanges evenly across the pool
+// (the split only depends on the stage size, so it is the same on both
+// parties)
+template <typename T, typename D>
+void run_stage(SessionPool& pool, T* key, D* data,
+               const std::vector<CompareExchange>& stage) {
+    const size_t n_workers = pool.size();
+    pool.run([&](size_t w) {
+        const size_t begin = stage.size() * w / n_workers;
+        const size_t end = stage.size() * (w + 1) / n_workers;
+        for (size_t k = begin; k < end; k++)
+            emp::cmp_swap(key, data, stage[k].i, stage[k].j,
+                          emp::Bit(stage[k].acc));
+    });
+}
+
+// greatest power of two strictly less than n (same as emp's bitonic merge)
+inline size_t greatest_power_of_two_less_than(size_t n) {
+    size_t k = 1;
+    while (k < n) k <<= 1;
+    return k >> 1;
+}
+
+// same network as emp::bitonic_merge, executed level by level: the
+// compare-exchanges of all the sub-merges at the same recursion depth are
+// independent and form one stage
+template <typename T, typename D = emp::Bit>
+void bitonic_merge(SessionPool& pool, T* key, D* data, size_t lo, size_t n,
+                   bool acc) {
+    if (pool.size() == 1) {
+        emp::bitonic_merge(key, data, lo, n, acc);
+        return;
+    }
+    std::vector<std::pair<size_t, size_t>> intervals = {{lo, n}};
+    std::vector<std::pair<size_t, size_t>> next;
+    std::vector<CompareExchange> stage;
+    while (!intervals.empty()) {
+        stage.clear();
+        next.clear();
+        for (auto& interval : intervals) {
+            const size_t l = interval.first;
+            const size_t c = interval.second;
+            if (c <= 1) continue;
+            const size_t m = greatest_power_of_two_less_than(c);
+            for (size_t i = l; i < l + c - m; i++)
+                stage.push_back({i, i + m, acc});
+            next.emplace_back(l, m);
+            next.emplace_back(l + m, c - m);
+        }
+        if (!stage.empty()) run_stage(pool, key, data, stage);
+        intervals.swap(next);
+    }
+}
+
+// iterative bitonic sort for any size: elements past the end are treated
+// as padding that is never swapped (i.e., +inf when sorting ascending,
+// -inf when descending), so out-of-range compare-exchanges are skipped.
+// Every stage has at most size/2 independent compare-exchanges.
+template <typename T, typename D = emp::Bit>
+void sort(SessionPool& pool, T* key, size_t size, D* data = nullptr,
+          bool acc = true) {
+    if (pool.size() == 1) {
+        emp::sort(key, size, data, acc);
+        return;
+    }
+    std::vector<CompareExchange> stage;
+    for (size_t k = 2; (k >> 1) < size; k <<= 1) {
+        // first step of each merge compares mirrored positions
+        stage.clear();
+        for (size_t i = 0; i < size; i++) {
+            const size_t l = i ^ (k - 1);
+            if (l > i && l < size) stage.push_back({i, l, acc});
+        }
+        run_stage(pool, key, data, stage);
+        for (size_t j = k >> 2; j > 0; j >>= 1) {
+            stage.clear();
+            for (size_t i = 0; i < size; i++) {
+                const size_t l = i ^ j;
+                if (l > i && l < size) stage.push_back({i, l, acc});
+            }
+            run_stage(pool, key, data, stage);
+        }
+    }
+}
+
+}  // namespace parallel
@@ -0,0 +1,365 @@
+// Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org>
+// Author: Roberta De Viti
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <emp-sh2pc/emp-sh2pc.h>
+
+// Oblivious permutations of emp::Integer arrays, and sorts that compare
+// narrow (key, index) pairs and move wide payloads only once.
+namespace permutation {
+
+// ---------------------------------------------------------------------------
+// Waksman network, for any n.
+// A network of about n * log2(n) - n + 1 switches that can route any
+// permutation. It is programmed in the clear by the party that knows the
+// permutation, and the switch bits are then fed into the circuit as that
+// party's input. Layout for n >= 2, with half = n / 2:
+// - input layer: half switches on pairs (2i, 2i+1), whose first output
+//   feeds the top subnetwork (half elements) and whose second output feeds
+//   the bottom one (n - half elements); for odd n, input n-1 goes straight
+//   to the bottom,
+// - output layer: switches on pairs (2j, 2j+1) fed by top output j and
+//   bottom output j, except for the last pair when n is even (fixed to top,
+//   bottom) and output n-1 when n is odd (fed straight from the bottom).
+// ---------------------------------------------------------------------------
+
+// number of switches in a Waksman network on n elements
+inline size_t waksman_size(size_t n) {
+    if (n < 2) return 0;
+    return (n - 1) + waksman_size(n / 2) + waksman_size(n - n / 2);
+}
+
+// program the switches so that output j receives input perm[j]
+// (looping algorithm), appending them to switches in evaluation order
+void waksman_program(const std::vector<size_t>& perm,
+                     std::vector<bool>& switches) {
+    const size_t n = perm.size();
+    if (n < 2) return;
+    const size_t half = n / 2;
+    std::vector<size_t> inv(n);
+    for (size_t j = 0; j < n; j++) inv[perm[j]] = j;
+
+    // assign each input to the top (0) or bottom (1) subnetwork. Two inputs
+    // sharing an input switch, or feeding the two outputs of an output
+    // switch, must go to different subnetworks: these constraints form
+    // paths and even cycles, so a walk along them colours every input.
+    // The unswitched wires are fixed: for odd n, input n-1 goes to the
+    // bottom and output n-1 comes from the bottom; for even n, output n-2
+    // comes from the top and output n-1 from the bottom.
+    std::vector<int> sub(n, -1);
+    auto output_switched = [&](size_t out) {
+        return (out ^ 1) < n && !(n % 2 == 0 && out >= n - 2);
+    };
+    auto walk = [&](size_t start, int colour) {
+        std::vector<std::pair<size_t, int>> todo = {{start, colour}};
+        while (!todo.empty()) {
+            const size_t x = todo.back().first;
+            const int c = todo.back().second;
+            todo.pop_back();
+            if (sub[x] != -1) continue;
+            sub[x] = c;
+            if ((x ^ 1) < n) todo.emplace_back(x ^ 1, 1 - c);
+            if (output_switched(inv[x]))
+                todo.emplace_back(perm[inv[x] ^ 1], 1 - c);
+        }
+    };
+    if (n % 2 == 1) {
+        walk(n - 1, 1);
+        walk(perm[n - 1], 1);
+    } else {
+        walk(perm[n - 2], 0);
+        walk(perm[n - 1], 1);
+    }
+    for (size_t x = 0; x < n; x++) walk(x, 0);
+
+    // input layer
+    for (size_t i = 0; i < half; i++) switches.push_back(sub[2 * i] == 1);
+
+    // subnetwork permutations: the input x enters its subnetwork at x / 2
+    const size_t n_out_switches = (n % 2 == 1) ? half : half - 1;
+    std::vector<size_t> top(half);
+    std::vector<size_t> bottom(n - half);
+    std::vector<bool> out_switches(n_out_switches);
+    for (size_t j = 0; j < n_out_switches; j++) {
+        // output switch j is crossed if output 2j comes from the bottom
+        out_switches[j] = (sub[perm[2 * j]] == 1);
+        top[j] = perm[2 * j + (out_switches[j] ? 1 : 0)] / 2;
+        bottom[j] = perm[2 * j + (out_switches[j] ? 0 : 1)] / 2;
+    }
+    if (n % 2 == 1) {
+        bottom[half] = perm[n - 1] / 2;
+    } else {
+        top[half - 1] = perm[n - 2] / 2;
+        bottom[half - 1] = perm[n - 1] / 2;
+    }
+    waksman_program(top, switches);
+    waksman_program(bottom, switches);
+    for (size_t j = 0; j < n_out_switches; j++)
+        switches.push_back(out_switches[j]);
+}
+
+// route data through the network, consuming switches from position pos
+void waksman_apply(const emp::Integer& switches, size_t& pos,
+                   emp::Integer* data, size_t n) {
+    if (n < 2) return;
+    const size_t half = n / 2;
+    std::vector<emp::Integer> top(half);
+    std::vector<emp::Integer> bottom(n - half);
+    for (size_t i = 0; i < half; i++) {
+        emp::swap(switches.bits[pos++], data[2 * i], data[2 * i + 1]);
+        top[i] = data[2 * i];
+        bottom[i] = data[2 * i + 1];
+    }
+    if (n % 2 == 1) bottom[half] = data[n - 1];
+    waksman_apply(switches, pos, &top[0], half);
+    waksman_apply(switches, pos, &bottom[0], n - half);
+    for (size_t j = 0; j < half; j++) {
+        data[2 * j] = top[j];
+        data[2 * j + 1] = bottom[j];
+    }
+    if (n % 2 == 1) data[n - 1] = bottom[half];
+    const size_t n_out_switches = (n % 2 == 1) ? half : half - 1;
+    for (size_t j = 0; j < n_out_switches; j++)
+        emp::swap(switches.bits[pos++], data[2 * j], data[2 * j + 1]);
+}
+
+// uniformly random permutation of [0, n), known only to the calling party
+std::vector<size_t> random_permutation(size_t n) {
+    std::vector<size_t> perm(n);
+    for (size_t i = 0; i < n; i++) perm[i] = i;
+    if (n < 2) return perm;
+    emp::PRG prg;
+    uint64_t r;
+    for (size_t i = n - 1; i > 0; i--) {
+        prg.random_data(&r, sizeof(r));
+        std::swap(perm[i], perm[r % (i + 1)]);
+    }
+    return perm;
+}
+
+// whether perm is a permutation of [0, n)
+bool is_permutation(const std::vector<size_t>& perm, size_t n) {
+    if (perm.size() != n) return false;
+    std::vector<bool> seen(n, false);
+    for (size_t p : perm) {
+        if (p >= n || seen[p]) return false;
+        seen[p] = true;
+    }
+    return true;
+}
+
+// permute data so that data[j] becomes data[perm[j]], where perm is only
+// known to programmer; the other party passes perm = nullptr.
+// The elements can be of any width (all of the same width).
+// If perm is not a permutation of [0, n), the programmer still runs the
+// network, on straight switches (data is left in place), so that the other
+// party, which cannot tell, stays in step; only the programmer returns false.
+bool permute(emp::Integer* data, size_t n, int programmer,
+             const std::vector<size_t>* perm) {
+    const size_t n_switches = waksman_size(n);
+    const bool valid = (perm == nullptr) || is_permutation(*perm, n);
+    if (!valid) {
+        std::cerr << "permute: not a permutation of " << n << " elements"
+                  << std::endl;
+    }
+    if (n_switches == 0) return valid;
+    bool* bools = new bool[n_switches]();
+    if (perm != nullptr && valid) {
+        std::vector<bool> switches;
+        switches.reserve(n_switches);
+        waksman_program(*perm, switches);
+        for (size_t i = 0; i < n_switches; i++) bools[i] = switches[i];
+    }
+    emp::Integer switch_bits;
+    switch_bits.init(bools, n_switches, programmer);
+    delete[] bools;
+    size_t pos = 0;
+    waksman_apply(switch_bits, pos, data, n);
+    return valid;
+}
+
+// secret shuffle: compose a random permutation chosen by ALICE with one
+// chosen by BOB, so neither party knows the result
+bool shuffle(emp::Integer* data, size_t n, int party) {
+    bool ok = true;
+    for (int programmer : {emp::ALICE, emp::BOB}) {
+        if (party == programmer) {
+            std::vector<size_t> perm = random_permutation(n);
+            ok &= permute(data, n, programmer, &perm);
+        } else {
+            ok &= permute(data, n, programmer, nullptr);
+        }
+    }
+    return ok;
+}
+
+// reveal a batch of bits publicly in a single round
+std::vector<bool> reveal_bits(const std::vector<emp::Bit>& bits) {
+    std::vector<bool> revealed(bits.size());
+    if (bits.empty()) return revealed;
+    emp::Integer packed;
+    packed.bits = bits;
+    bool* bools = new bool[bits.size()];
+    packed.revealBools(bools, emp::PUBLIC);
+    for (size_t i = 0; i < bits.size(); i++) revealed[i] = bools[i];
+    delete[] bools;
+    return revealed;
+}
+
+// Records for the shuffle-based sorts: [original index | key | payload],
+// shuffled with a secret permutation.
+// The first idx_bits + key_bits bits of a record are its sort key
+// (key || original index): signed on the key, unsigned on the index, and
+// distinct for every record.
+struct ShuffledRecords {
+    std::vector<emp::Integer> records;
+    size_t idx_bits;
+    size_t key_bits;
+    size_t payload_bits;
+
+    ShuffledRecords(const emp::Integer* key, size_t size,
+                    const emp::Integer* payload, int party) {
+        idx_bits = floor(log2(size - 1)) + 1;
+        key_bits = key[0].size();
+        payload_bits = (payload == nullptr) ? 0 : payload[0].size();
+
+        records.resize(size);
+        for (size_t i = 0; i < size; i++) {
+            emp::Integer index(idx_bits, i, emp::PUBLIC);
+            std::vector<emp::Bit>& bits = records[i].bits;
+            bits.reserve(idx_bits + key_bits + payload_bits);
+            bits.insert(bits.end(), index.bits.begin(), index.bits.end());
+            bits.insert(bits.end(), key[i].bits.begin(), key[i].bits.end());
+            if (payload != nullptr)
+                bits.insert(bits.end(), payload[i].bits.begin(),
+                            payload[i].bits.end());
+        }
+        // the sorts reveal comparisons over the shuffled records, which
+        // would leak their order if they were left unshuffled
+        if (!shuffle(&records[0], size, party)) {
+            std::cerr << "ShuffledRecords: the shuffle failed" << std::endl;
+            exit(1);
+        }
+    }
+
+    emp::Integer sort_key(size_t r) const {
+        emp::Integer out;
+        out.bits.assign(records[r].bits.begin(),
+                        records[r].bits.begin() + idx_bits + key_bits);
+        return out;
+    }
+
+    // write the records back in the given (public) order
+    void unpack(const std::vector<size_t>& order, emp::Integer* key,
+                emp::Integer* payload) const {
+        for (size_t i = 0; i < order.size(); i++) {
+            const auto begin = records[order[i]].bits.begin() + idx_bits;
+            key[i].bits.assign(begin, begin + key_bits);
+            if (payload != nullptr)
+                payload[i].bits.assign(begin + key_bits,
+                                       begin + key_bits + payload_bits);
+        }
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Sort by index.
+// Same result as emp::sort(key, size, payload, acc), but the payload is only
+// moved by the shuffle (O(n log n) wide switches) instead of at every
+// comparator (O(n log^2 n) wide swaps):
+// 1. shuffle (key, payload, original index) with a secret permutation,
+// 2. sort (key || original index) carrying only the public position tag,
+// 3. reveal the sorted tags and relabel the shuffled payload in the clear.
+// The original index makes all sort keys distinct, so the revealed tags are
+// a uniformly random permutation, independent of the input.
+// ---------------------------------------------------------------------------
+void sort_by_index(emp::Integer* key, size_t size, emp::Integer* payload,
+                   int party, bool acc = true) {
+    if (size < 2) return;
+    const ShuffledRecords shuffled(key, size, payload, party);
+
+    std::vector<emp::Integer> sort_key(size);
+    std::vector<emp::Integer> tag(size);
+    for (size_t i = 0; i < size; i++) {
+        sort_key[i] = shuffled.sort_key(i);
+        tag[i] = emp::Integer(shuffled.idx_bits + 1, i, emp::PUBLIC);
+    }
+    emp::sort(&sort_key[0], size, &tag[0], acc);
+
+    std::vector<emp::Bit> tag_bits;
+    tag_bits.reserve(size * shuffled.idx_bits);
+    for (size_t i = 0; i < size; i++)
+        tag_bits.insert(tag_bits.end(), tag[i].bits.begin(),
+                        tag[i].bits.begin() + shuffled.idx_bits);
+    const std::vector<bool> revealed = reveal_bits(tag_bits);
+    std::vector<size_t> order(size, 0);
+    for (size_t i = 0; i < size; i++)
+        for (size_t b = 0; b < shuffled.idx_bits; b++)
+            if (revealed[i * shuffled.idx_bits + b]) order[i] |= (size_t)1 << b;
+    shuffled.unpack(order, key, payload);
+}
+
+// ---------------------------------------------------------------------------
+// Shuffle-then-sort.
+// Same result as emp::sort(key, size, payload, acc) with O(n log n) garbled
+// comparisons instead of the O(n log^2 n) of a bitonic network: after the
+// secret shuffle, the records are quicksorted in the clear and only the
+// outcome of each comparison is revealed. Since the sort keys are distinct
+// and the order of the records is uniformly random, the sequence of
+// outcomes is independent of the input.
+// All the comparisons against the pivots of one recursion level are
+// independent, so they are garbled and revealed in one batch: O(log n)
+// rounds in expectation. The payload (may be nullptr) is never touched by
+// the comparisons, it is moved by the shuffle and then relabelled.
+// ---------------------------------------------------------------------------
+void shuffle_sort(emp::Integer* key, size_t size, emp::Integer* payload,
+                  int party, bool acc = true) {
+    if (size < 2) return;
+    const ShuffledRecords shuffled(key, size, payload, party);
+    std::vector<emp::Integer> sort_key(size);
+    for (size_t i = 0; i < size; i++) sort_key[i] = shuffled.sort_key(i);
+
+    // order holds record positions; segments are [lo, hi) ranges still to
+    // be sorted, each with its pivot at lo (a uniformly random element)
+    std::vector<size_t> order(size);
+    for (size_t i = 0; i < size; i++) order[i] = i;
+    std::vector<std::pair<size_t, size_t>> segments = {{0, size}};
+    std::vector<std::pair<size_t, size_t>> next;
+    std::vector<emp::Bit> before_pivot;
+    std::vector<size_t> before;
+    std::vector<size_t> after;
+    while (!segments.empty()) {
+        before_pivot.clear();
+        for (auto& segment : segments) {
+            const emp::Integer& pivot = sort_key[order[segment.first]];
+            for (size_t i = segment.first + 1; i < segment.second; i++) {
+                const emp::Integer& x = sort_key[order[i]];
+                before_pivot.push_back(acc ? (x < pivot) : (x > pivot));
+            }
+        }
+        const std::vector<bool> revealed = reveal_bits(before_pivot);
+
+        size_t k = 0;
+        next.clear();
+        for (auto& segment : segments) {
+            const size_t lo = segment.first;
+            const size_t hi = segment.second;
+            const size_t pivot = order[lo];
+            before.clear();
+            after.clear();
+            for (size_t i = lo + 1; i < hi; i++)
+                (revealed[k++] ? before : after).push_back(order[i]);
+            size_t pos = lo;
+            for (size_t r : before) order[pos++] = r;
+            order[pos++] = pivot;
+            for (size_t r : after) order[pos++] = r;
+            if (before.size() > 1) next.emplace_back(lo, lo + before.size());
+            if (after.size() > 1) next.emplace_back(hi - after.size(), hi);
+        }
+        segments.swap(next);
+    }
+    shuffled.unpack(order, key, payload);
+}
+
+}  // namespace permutation
@@ -15,6 +15,35 @@ emp::Integer inner_product(std::vector<emp::Integer>& a,
 	return result;
 }
 
+// list entries: a fingerprint with an invalid flag on top (the sign bit).
+// An invalid entry has its fingerprint cleared, so every invalid entry is
+// none_entry(), the most negative value, as the old none sentinel was: an
+// ascending sort puts invalid entries first, a descending sort last.
+// Reading the flag costs no gates.
+emp::Integer make_entry(const emp::Integer& value, const emp::Bit& valid) {
+    emp::Integer entry = value;
+    for (size_t k = 0; k < entry.bits.size(); k++)
+        entry.bits[k] = entry.bits[k] & valid;
+    entry.bits.push_back(!valid);
+    return entry;
+}
+
+emp::Integer none_entry(const size_t size) {
+    emp::Integer entry(size, 0, emp::PUBLIC);
+    entry.bits.back() = emp::Bit(true, emp::PUBLIC);
+    return entry;
+}
+
+emp::Bit valid_bit(const emp::Integer& entry) { return !entry.bits.back(); }
+
+// turn entry into none_entry() if condition is set
+void invalidate(emp::Integer& entry, const emp::Bit& condition) {
+    const emp::Bit keep = !condition;
+    for (size_t k = 0; k < entry.bits.size() - 1; k++)
+        entry.bits[k] = entry.bits[k] & keep;
+    entry.bits.back() = entry.bits.back() | condition;
+}
+
 // tight-order preserving compaction algorithm:
 // https://arxiv.org/pdf/1103.5102.pdf
 void compact(std::vector<emp::Integer>& distance,
@@ -52,7 +81,7 @@ void compact(std::vector<emp::Integer>& distance,
     }
 }
 
-// tight-order preserving compaction algorithm:
+// tight-order preserving compaction algorithm, on list entries:
 // https://arxiv.org/pdf/1103.5102.pdf
 void compact(std::vector<emp::Integer>& distance, emp::Integer* data,
              size_t size) {
@@ -60,8 +89,6 @@ void compact(std::vector<emp::Integer>& distance, emp::Integer* data,
     emp::Integer zero_mask = emp::Integer(n_bits, 0, emp::PUBLIC);
     emp::Integer move_mask = emp::Integer(n_bits, 0, emp::PUBLIC);
     emp::Integer one_mask = emp::Integer(n_bits, 0x01, emp::PUBLIC);
-    emp::Integer move_data_mask =
-        emp::Integer(data[0].bits.size(), -1, emp::PUBLIC);
     emp::Integer modulo, new_distance;
     emp::Bit move;
     int index = 0;
@@ -82,13 +109,7 @@ void compact(std::vector<emp::Integer>& distance, emp::Integer* data,
                 move_mask.bits[k] = !move;
             distance[j] = new_distance & move_mask;
             // if data has been moved, clean up the old cell
-            for (size_t k = 0; k < move_data_mask.bits.size() - 1; k++)
-                move_data_mask.bits[k] = !move;
-            data[j] = data[j] & move_data_mask;
-            // if move = 1, clear last bit to have none = max 32-bit negative
-            // int
-            data[j].bits[data[0].bits.size() - 1] =
-                data[j].bits[data[0].bits.size() - 1] | move;
+            invalidate(data[j], move);
         }
     }
 }
@@ -145,4 +166,89 @@ std::vector<emp::Integer> aggregate(std::vector<emp::Integer>& list) {
     return count;
 }
 
+// flag the first element of every run of equal values in a sorted list
+// (heads[0] is always set); the flags delimit the segments of the scans below
+std::vector<emp::Bit> segment_heads(const emp::Integer* list, size_t size) {
+    std::vector<emp::Bit> heads;
+    heads.reserve(size);
+    heads.emplace_back(emp::Bit(1, emp::PUBLIC));
+    for (size_t i = 1; i < size; i++) heads.emplace_back(!(list[i] == list[i - 1]));
+    return heads;
+}
+
+// log-depth segmented inclusive prefix scan (Hillis-Steele) over
+// (head, value) pairs: afterwards values[i] = op(values[h], ..., values[i]),
+// where h is the head of the segment containing i.
+// There are ceil(log2(size)) rounds, and all the selections within a round
+// are independent of each other, unlike the chain of Ifs in aggregate().
+template <typename Op>
+void segmented_scan(std::vector<emp::Bit> heads, emp::Integer* values,
+                    size_t size, Op op) {
+    for (size_t d = 1; d < size; d <<= 1) {
+        // walk backwards so that [i - d] still holds the previous round
+        for (size_t i = size; i-- > d;) {
+            values[i] = emp::If(heads[i], values[i], op(values[i - d], values[i]));
+            heads[i] = heads[i] | heads[i - d];
+        }
+    }
+}
+
+// group-by count: count[i] is the number of elements equal to list[i] up to i
+std::vector<emp::Integer> segmented_count(const emp::Integer* list,
+                                          size_t size, size_t count_bits) {
+    const emp::Integer one = emp::Integer(count_bits, 1, emp::PUBLIC);
+    std::vector<emp::Integer> count(size, one);
+    segmented_scan(segment_heads(list, size), &count[0], size,
+                   [](const emp::Integer& a, const emp::Integer& b) {
+                       return a + b;
+                   });
+    return count;
+}
+
+// group-by sum of values, keyed by the sorted list
+void segmented_sum(const emp::Integer* list, emp::Integer* values,
+                   size_t size) {
+    segmented_scan(segment_heads(list, size), values, size,
+                   [](const emp::Integer& a, const emp::Integer& b) {
+                       return a + b;
+                   });
+}
+
+// group-by max of values, keyed by the sorted list
+void segmented_max(const emp::Integer* list, emp::Integer* values,
+                   size_t size) {
+    segmented_scan(segment_heads(list, size), values, size,
+                   [](const emp::Integer& a, const emp::Integer& b) {
+                       return emp::If(a > b, a, b);
+                   });
+}
 
+// after a segmented scan, the last element of each segment holds the
+// aggregate of the whole group: replace all other elements with none in
+// list, and with fill in values
+void keep_segment_tails(const std::vector<emp::Bit>& heads, emp::Integer* list,
+                        emp::Integer* values, size_t size,
+                        const emp::Integer& none, const emp::Integer& fill) {
+    for (size_t i = 0; i < size - 1; i++) {
+        list[i] = emp::If(heads[i + 1], list[i], none);
+        values[i] = emp::If(heads[i + 1], values[i], fill);
+    }
+}
+
+// same output as aggregate(), computed with a log-depth segmented scan
+std::vector<emp::Integer> aggregate_scan(std::vector<emp::Integer>& list) {
+    size_t count_bits = floor(log2(list.size() - 1)) + 1;
+    const emp::Integer none =
+        emp::Integer(list[0].bits.size(), -1, emp::PUBLIC);
+    const emp::Integer none_count = emp::Integer(count_bits, -1, emp::PUBLIC);
+    std::vector<emp::Bit> heads = segment_heads(&list[0], list.size());
+    std::vector<emp::Integer> count(
+        list.size(), emp::Integer(count_bits, 1, emp::PUBLIC));
+    segmented_scan(heads, &count[0], count.size(),
+                   [](const emp::Integer& a, const emp::Integer& b) {
+                       return a + b;
+                   });
+    keep_segment_tails(heads, &list[0], &count[0], list.size(), none,
+                       none_count);
+    return count;
+}
@@ -9,28 +9,23 @@
 #include "include/types.h"
 
 // compute distance for the compact primitive (pre-processing step)
-// also marks duplicates (expects sorted list)
+// also marks duplicates (expects sorted list entries)
 std::vector<emp::Integer> compute_distance_mark_duplicates(emp::Integer* list, size_t size) {
     size_t n_bits = floor(log2(size - 1)) + 1;
     const emp::Integer zero = emp::Integer(n_bits, 0, emp::PUBLIC);
     const emp::Integer one = emp::Integer(n_bits, 1, emp::PUBLIC);
-    const emp::Integer none =
-        emp::Integer(list[0].bits.size(), -2147483648, emp::PUBLIC);
     emp::Integer count_none = zero;
     emp::Bit condition;
     std::vector<emp::Integer> distance;
     for (size_t i = 0; i < size; i++) {
-        // mark duplicates
-        if (i < size - 1)
-            list[i] = emp::If(list[i] == list[i + 1], none, list[i]);
-        // can be none for other reaons (e.g., invalid) thus list[i] ==
-        // list[i+1] alone would not work
-        condition = (list[i] == none);
+        // mark duplicates: invalid entries are all none_entry(), so a valid
+        // entry never equals one
+        if (i < size - 1) invalidate(list[i], list[i] == list[i + 1]);
+        // can be invalid for other reasons too (e.g., not a contact)
+        condition = !valid_bit(list[i]);
         distance.emplace_back(emp::If(condition, zero, count_none));
         count_none = count_none + emp::If(condition, one, zero);
     }
-    list[size - 1] =
-        emp::If(list[size - 1] == list[size - 2], none, list[size - 1]);
     return distance;
 }
 
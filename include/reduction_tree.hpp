@@ -0,0 +1,260 @@
+// Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org>
+// Author: Roberta De Viti
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <emp-sh2pc/emp-sh2pc.h>
+#include "include/io.hpp"
+#include "include/parallel_sort.hpp"
+#include "include/reducer.hpp"
+#include "include/utils/parser.hpp"
+
+// One node of a reduction tree of any depth and fan-in.
+// A node receives lists from its upstream endpoints (mappers or other
+// reducer nodes), merges them, marks duplicates, compacts, cuts the result
+// at output_size and sends it downstream (or keeps it, at the root).
+// The shape of the tree is entirely given by the per-node configuration.
+namespace reduction {
+
+// a list source: the node listens on port and receives n_lists lists of
+// list_size entries each. Lists from reducer nodes are already sorted and
+// compacted ([valid entries ascending | invalid]), lists from mappers are not.
+struct Upstream {
+    int port = -1;
+    size_t n_lists = 1;
+    size_t list_size = 0;
+    bool sorted = false;
+};
+
+struct TreeNode {
+    int party = -1;
+    int port = -1;
+    std::string peer_ip = "127.0.0.1"s;
+    size_t output_size = 0;
+    std::vector<Upstream> upstream;
+    // no downstream at the root
+    std::string downstream_ip = ""s;
+    int downstream_port = -1;
+    // merge each list into a bounded window as soon as it arrives
+    bool streaming = true;
+    int n_workers = 1;
+    // session of the node's pool (see parallel::pool_port)
+    int pool_session = 0;
+    int n_reps = 1;
+    std::string outfile = ""s;
+
+    bool is_root() const { return downstream_port < 0; }
+
+    size_t n_lists() const {
+        size_t n = 0;
+        for (auto& u : upstream) n += u.n_lists;
+        return n;
+    }
+};
+
+// reduction tree node parser
+void parse(std::string file, TreeNode& node) {
+    // reading JSON file
+    FILE* fp = fopen(file.c_str(), "r");
+    if (!fp) {
+        std::cout << "Error: The JSON file in input does not exist: " << file
+                  << std::endl;
+        std::exit(-1);
+    }
+    char input[65536];
+    rapidjson::FileReadStream is(fp, input, sizeof(input));
+    rapidjson::Document d;
+    d.ParseStream(is);
+    fclose(fp);
+
+    if (!d.HasMember("options")) {
+        std::cerr << "Error: Options missing in JSON input!\n";
+        std::exit(-1);
+    }
+    const rapidjson::Value& options = d["options"];
+    // check necessary fields
+    if (options.HasMember("party") && options.HasMember("port") &&
+        options.HasMember("output_size") && options.HasMember("upstream") &&
+        options["upstream"].IsArray()) {
+        node.party = options["party"].GetInt();
+        node.port = options["port"].GetInt();
+        node.output_size = options["output_size"].GetInt();
+        for (auto& u : options["upstream"].GetArray()) {
+            if (!u.HasMember("port") || !u.HasMember("list_size")) {
+                std::cerr << "Error: Required upstream fields missing in "
+                             "JSON input!\n";
+                std::exit(0);
+            }
+            Upstream upstream;
+            upstream.port = u["port"].GetInt();
+            upstream.list_size = u["list_size"].GetInt();
+            if (u.HasMember("n_lists")) upstream.n_lists = u["n_lists"].GetInt();
+            if (u.HasMember("sorted")) upstream.sorted = u["sorted"].GetBool();
+            node.upstream.push_back(upstream);
+        }
+    } else {
+        std::cerr << "Error: Required fields missing in JSON input!\n";
+        std::exit(0);
+    }
+    // check optional fields
+    if (options.HasMember("peer_ip"))
+        node.peer_ip = options["peer_ip"].GetString();
+    if (options.HasMember("downstream_ip"))
+        node.downstream_ip = options["downstream_ip"].GetString();
+    if (options.HasMember("downstream_port"))
+        node.downstream_port = options["downstream_port"].GetInt();
+    if (options.HasMember("streaming"))
+        node.streaming = options["streaming"].GetBool();
+    if (options.HasMember("n_workers"))
+        node.n_workers = options["n_workers"].GetInt();
+    if (options.HasMember("pool_session"))
+        node.pool_session = options["pool_session"].GetInt();
+    if (options.HasMember("n_reps")) node.n_reps = options["n_reps"].GetInt();
+    if (options.HasMember("outfile"))
+        node.outfile = options["outfile"].GetString();
+
+    std::cout << "Input variables (PID: " << getpid() << "): " << std::endl
+              << "Party\t\t" << node.party << std::endl
+              << "Peer IP\t\t" << node.peer_ip << std::endl
+              << "Port\t\t" << node.port << std::endl
+              << "Fan-in\t\t" << node.upstream.size() << std::endl
+              << "Output Size\t" << node.output_size << std::endl
+              << "Streaming\t" << node.streaming << std::endl
+              << "Downstream\t"
+              << (node.is_root() ? "none (root)"s
+                                 : node.downstream_ip + ":" +
+                                       std::to_string(node.downstream_port))
+              << std::endl
+              << "Repetitions\t" << node.n_reps << std::endl
+              << "\n";
+
+    if (node.upstream.empty() || node.output_size == 0) {
+        std::cerr << "Error: a node needs at least one upstream and a "
+                     "non-zero output_size!"
+                  << std::endl;
+        std::exit(-1);
+    }
+}
+
+// Merging order: compaction leaves invalid entries (none_entry(), the most
+// negative value) at the end of a list, so the invalid flag is flipped while
+// merging. Valid entries then become negative and invalid ones 0, which keeps
+// the order of the valid entries and puts the invalid ones after them, so a
+// compacted list is sorted ascending. Flipping a bit costs no gates.
+void to_merge_order(emp::Integer* list, size_t size) {
+    for (size_t i = 0; i < size; i++)
+        list[i].bits.back() = !list[i].bits.back();
+}
+
+void from_merge_order(emp::Integer* list, size_t size) {
+    to_merge_order(list, size);
+}
+
+// merge sorted runs (ascending, in merging order) pairwise in a balanced
+// tree: emp's bitonic merge sorts a descending run followed by an
+// ascending run of any lengths, so the first run of each pair is reversed
+std::vector<emp::Integer> merge_runs(
+    parallel::SessionPool& pool, std::vector<std::vector<emp::Integer>>& runs) {
+    while (runs.size() > 1) {
+        std::vector<std::vector<emp::Integer>> next;
+        for (size_t r = 0; r + 1 < runs.size(); r += 2) {
+            std::vector<emp::Integer> merged(runs[r].rbegin(), runs[r].rend());
+            merged.insert(merged.end(), runs[r + 1].begin(), runs[r + 1].end());
+            parallel::bitonic_merge(pool, &merged[0], (emp::Bit*)nullptr, 0,
+                                    merged.size(), true);
+            next.push_back(std::move(merged));
+        }
+        if (runs.size() % 2 == 1) next.push_back(std::move(runs.back()));
+        runs.swap(next);
+    }
+    return runs.empty() ? std::vector<emp::Integer>() : std::move(runs[0]);
+}
+
+// the merge-dedupe-compact step: merge the runs, mark duplicates, compact
+// and cut at output_size. The result is [valid entries ascending | invalid].
+std::vector<emp::Integer> reduce(parallel::SessionPool& pool,
+                                 std::vector<std::vector<emp::Integer>>& runs,
+                                 size_t output_size) {
+    std::vector<emp::Integer> list = merge_runs(pool, runs);
+    from_merge_order(&list[0], list.size());
+    if (list.size() > 1) {
+        std::vector<emp::Integer> distance =
+            compute_distance_mark_duplicates(&list[0], list.size());
+        compact(distance, &list[0], list.size());
+    }
+    list.resize(output_size, none_entry(entrybits));
+    return list;
+}
+
+// Streaming version of reduce(): a sorted, de-duplicated window of at most
+// output_size valid entries. Every run is merged into the window, then the
+// window is immediately de-duplicated, compacted and cut at output_size, so
+// memory and the size of each step's circuit are O(output_size + run size)
+// however many runs arrive. The result is the same as reduce() on all the
+// runs, since both keep the output_size smallest distinct values.
+class Window {
+   private:
+    // in merging order, ascending
+    std::vector<emp::Integer> list;
+    size_t output_size;
+    bool empty = true;
+
+   public:
+    Window(size_t output_size) : output_size(output_size) {}
+
+    // run: ascending, in merging order
+    void add(parallel::SessionPool& pool, std::vector<emp::Integer>& run) {
+        std::vector<emp::Integer> merged;
+        if (empty) {
+            merged.swap(run);
+            empty = false;
+        } else {
+            merged.reserve(list.size() + run.size());
+            merged.assign(list.rbegin(), list.rend());
+            merged.insert(merged.end(), run.begin(), run.end());
+            parallel::bitonic_merge(pool, &merged[0], (emp::Bit*)nullptr, 0,
+                                    merged.size(), true);
+        }
+        from_merge_order(&merged[0], merged.size());
+        if (merged.size() > 1) {
+            std::vector<emp::Integer> distance =
+                compute_distance_mark_duplicates(&merged[0], merged.size());
+            compact(distance, &merged[0], merged.size());
+        }
+        merged.resize(output_size, none_entry(entrybits));
+        to_merge_order(&merged[0], merged.size());
+        list.swap(merged);
+    }
+
+    // [valid entries ascending | invalid]
+    std::vector<emp::Integer> result() const {
+        std::vector<emp::Integer> out = list;
+        if (out.empty())
+            out.assign(output_size, none_entry(entrybits));
+        else
+            from_merge_order(&out[0], out.size());
+        return out;
+    }
+};
+
+// receive one list from an upstream and turn it into a sorted run
+std::vector<emp::Integer> receive_run(parallel::SessionPool& pool,
+                                      emp::NetIO& io,
+                                      const Upstream& upstream) {
+    std::vector<emp::Integer> run(upstream.list_size);
+    receive_list(io, &run[0], upstream.list_size);
+    to_merge_order(&run[0], run.size());
+    if (!upstream.sorted)
+        parallel::sort(pool, &run[0], run.size(), (emp::Bit*)nullptr, true);
+    return run;
+}
+
+// send the output list downstream, in order
+void send_run(emp::NetIO& io, const std::vector<emp::Integer>& list) {
+    for (size_t i = 0; i < list.size(); i++)
+        for (size_t j = 0; j < entrybits; j++)
+            io.send_block(&list[i].bits[j].bit, 1);
+    io.flush();
+}
+
+}  // namespace reduction
@@ -5,9 +5,14 @@
 #pragma once
 #include <emp-tool/emp-tool.h>
 #include <emp-sh2pc/emp-sh2pc.h>
+#include <emp-tool/circuits/aes_128_ctr.h>
+#include <emp-tool/circuits/sha3_256.h>
+#include <map>
+#include <memory>
 #include <boost/functional/hash.hpp>
 #include <boost/multiprecision/cpp_int.hpp>
 #include <include/encounter.hpp>
+#include <include/utils/sync.hpp>
 
 using namespace boost::multiprecision;
 namespace secrets {
@@ -61,6 +66,62 @@ const static Hash_256 SHA3_256_OF_LEFT_SECRET_XOR_RIGHT_SECRET =
         0x09, 0x75, 0x33, 0x70, 0x2c, 0x37, 0x92, 0x39, 0xd4, 0xba, 0xdc,
         0x61, 0x73, 0x9a, 0x94, 0x5c, 0x61, 0x70, 0xc1, 0x3c, 0xd3};
 
+// The keyed PRF used for macs, device secrets and shuffle keys.
+// SHA3_256 is SHA3-256(key || input), one Keccak-f per call in circuit (38400 ANDs).
+// AES_128 is a CBC-MAC under bytes 16..31 of the key (bytes 0..15 are the AES-CTR keys of the shuffles), with the
+// input length as its first block, and the last block run in counter mode for 256 bits of output:
+// ceil(bits / 128) + 1 AES blocks per call in circuit (about 6800 ANDs each), e.g. 3 to rekey a 256-bit key.
+// Both sides, and every shuffle of a store, must use the same one.
+enum class PRF { SHA3_256, AES_128 };
+
+// first byte of a key used as the AES_128 PRF key
+const static size_t PRF_KEY_OFFSET = 16;
+
+// the keyed PRF out of circuit: the same 32 bytes as Reusable_Secrets::prf on the same key and input (size in bytes)
+inline void prf(const PRF f, uint8_t output[32], const uint8_t key[32], const uint8_t input[], const size_t size) {
+    if (f == PRF::SHA3_256) {
+        std::vector<uint8_t> hashMe(SECRET_SIZE + size);
+        memcpy(hashMe.data(), key, SECRET_SIZE);
+        memcpy(hashMe.data() + SECRET_SIZE, input, size);
+        emp::sha3_256(output, hashMe.data(), hashMe.size());
+        return;
+    }
+    const __m128i k = _mm_loadu_si128((const __m128i *) (key + PRF_KEY_OFFSET));
+    const uint8_t zeros[32] = {0};
+    uint8_t chain[16] = {0};
+    uint8_t next[16];
+    // the first block is the length in bits
+    ((uint64_t *) chain)[0] = 8 * size;
+    emp::aes_128_ctr<uint8_t>(k, _mm_loadu_si128((const __m128i *) chain), zeros, next, 16);
+    memcpy(chain, next, 16);
+    const size_t blocks = (size + 15) / 16;
+    for (size_t j = 0; j < blocks; ++j) {
+        // zero-padded
+        for (size_t i = 0; i < 16 && 16 * j + i < size; ++i) {
+            chain[i] ^= input[16 * j + i];
+        }
+        if (j + 1 < blocks) {
+            emp::aes_128_ctr<uint8_t>(k, _mm_loadu_si128((const __m128i *) chain), zeros, next, 16);
+            memcpy(chain, next, 16);
+        }
+    }
+    emp::aes_128_ctr<uint8_t>(k, _mm_loadu_si128((const __m128i *) chain), zeros, output, 32);
+}
+
+// rekey a 32-byte key with a side's secret out of circuit, as shuffles and fetches do (output may be key)
+inline void rekey(const PRF f, uint8_t output[32], const uint8_t secret[32], const uint8_t key[32]) {
+    if (f == PRF::SHA3_256) {
+        __m256i hashMe[2];
+        hashMe[0] = _mm256_loadu_si256((const __m256i *) secret);
+        hashMe[1] = _mm256_loadu_si256((const __m256i *) key);
+        emp::sha3_256(output, hashMe, 2);
+        return;
+    }
+    uint8_t input[32];
+    memcpy(input, key, 32);
+    prf(f, output, secret, input, 32);
+}
+
 // Create one of these when you want to do stuff in circuit involving LEFT_SECRET or RIGHT_SECRET
 // At creation time, we check the hash of their secrets to ensure they're
 // entered correctly.
@@ -73,6 +134,8 @@ class Reusable_Secrets {
     emp::Integer left_xor_right;
     emp::SHA3_256_Calculator sha3;
     bool alice_is_left;
+    // the keyed PRF of mac(), device() and rekey(): both sides must set the same one
+    PRF prf_choice = PRF::SHA3_256;
 
     Reusable_Secrets(const bool is_alice_left = true, const char * debug_preamble = "", emp::NetIO * io = nullptr) {
         alice_is_left = is_alice_left;
@@ -88,14 +151,14 @@ class Reusable_Secrets {
         right.init(bools, 256, right_party());
 
         if (io != nullptr) {
-          io->sync();
+          debug_sync(io);
         }
         std::cout << debug_preamble << "preparing to left_xor_right = left ^ right" << std::endl << std::flush;
         // xor them for the xored secret
         left_xor_right = left ^ right;
         std::cout << debug_preamble << "completed left_xor_right = left ^ right" << std::endl << std::flush;
         if (io != nullptr) {
-          io->sync();
+          debug_sync(io);
         }
 
         // check the hash of the xored secret
@@ -104,12 +167,12 @@ class Reusable_Secrets {
         sha3.sha3_256(&hash_of_left_xor_right, &left_xor_right);
         std::cout << debug_preamble << "hash calculated. preparing to reveal" << std::endl << std::flush;
         if (io != nullptr) {
-          io->sync();
+          debug_sync(io);
         }
         hash_of_left_xor_right.reveal(revealed, emp::PUBLIC);
         std::cout << debug_preamble << "hash revealed. preparing to check" << std::endl << std::flush;
         if (io != nullptr) {
-          io->sync();
+          debug_sync(io);
         }
         for (size_t i = 0; i < 32; ++i) {
             if (revealed[i] != SHA3_256_OF_LEFT_SECRET_XOR_RIGHT_SECRET[i]) {
@@ -178,14 +241,56 @@ class Reusable_Secrets {
       return alice_is_left ? RIGHT_SECRET : LEFT_SECRET;
     }
 
+    void set_prf(const PRF f) {
+        prf_choice = f;
+    }
+
+    // the keyed PRF in circuit, on a 256-bit key and size bits of input: 256 bits of output.
+    // the key and input are both wires already, as in decrypt_path_encounter: party is passed on to the AES calculator.
+    void prf(block output[], const emp::Integer* key, const block input[], const size_t size, const int party = emp::PUBLIC) {
+        if (prf_choice == PRF::SHA3_256) {
+            const block* inputs[2] = {&(key->bits[0].bit), input};
+            const size_t sizes[2] = {8 * SECRET_SIZE, size};
+            sha3.sha3_256(output, inputs, sizes, 2);
+            return;
+        }
+        const block* k = &(key->bits[8 * PRF_KEY_OFFSET].bit);
+        emp::Integer chain = prf_length_block(key, size, party);
+        const size_t blocks = (size + 127) / 128;
+        for (size_t j = 0; j < blocks; ++j) {
+            // zero-padded
+            for (size_t i = 0; i < 128 && 128 * j + i < size; ++i) {
+                emp::Bit in;
+                in.bit = input[128 * j + i];
+                chain.bits[i] = chain.bits[i] ^ in;
+            }
+            if (j + 1 < blocks) {
+                prf_aes(k, &chain, 128, party);
+            }
+        }
+        prf_aes(k, &chain, 256, party);
+        for (size_t i = 0; i < 256; ++i) {
+            output[i] = chain.bits[i].bit;
+        }
+    }
+
+    // rekey a 256-bit key with side's secret in circuit: the in-circuit half of rekey() above
+    void rekey(emp::Integer* output, const Side side, const emp::Integer* key) {
+        if (prf_choice == PRF::SHA3_256) {
+            const emp::Integer rehash_array[2] = {*secret_circuit(side), *key};
+            sha3.sha3_256(output, rehash_array, 2);
+            return;
+        }
+        output->bits.resize(256);
+        prf(&(output->bits[0].bit), secret_circuit(side), &(key->bits[0].bit), 256, party(side));
+    }
+
     // one thing we can do with these secrets is create a mac that can only be
     // generated in circuit, and can be verified later.
     // This is overloaded because you can use Integers or block[]s.
     // output will always be 256 bits. 
     void mac(block output[], const block input[], const size_t size) {
-        const block* inputs[2] = {&(left_xor_right.bits[0].bit), input};
-        const size_t sizes[2] = {8 * SECRET_SIZE, size};
-        sha3.sha3_256(output, inputs, sizes, 2);
+        prf(output, &left_xor_right, input, size, left_party());
     }
 
     void mac(block output[], const emp::Integer* input) {
@@ -222,5 +327,37 @@ class Reusable_Secrets {
     void device(emp::Integer* device_secret, const emp::Integer* device_id) {
         mac(device_secret, device_id);
     }
+
+   private:
+    std::unique_ptr<emp::AES_128_CTR_Calculator> aes;
+    // the first chain block of the AES PRF depends only on the key and the input length: kept per (secret, length)
+    // for the secrets above (0: left, 1: right, 2: left_xor_right)
+    std::map<std::pair<int, size_t>, emp::Integer> length_blocks;
+
+    // chain = the first bits of AES_128_CTR under key k with chain as its IV, in place
+    void prf_aes(const block* k, emp::Integer* chain, const size_t bits, const int party) {
+        if (!aes) {
+            aes.reset(new emp::AES_128_CTR_Calculator());
+        }
+        emp::Integer stream(bits, 0, emp::PUBLIC);
+        if (aes->aes_128_ctr(k, &(chain->bits[0].bit), &(stream.bits[0].bit), nullptr, bits, party) < 0) {
+            std::cerr << "ERROR: AES PRF failed in aes_128_ctr\n" << std::flush;
+        }
+        *chain = stream;
+    }
+
+    emp::Integer prf_length_block(const emp::Integer* key, const size_t size, const int party) {
+        const int owned = (key == &left) ? 0 : (key == &right) ? 1 : (key == &left_xor_right) ? 2 : -1;
+        auto found = length_blocks.find({owned, size});
+        if (owned >= 0 && found != length_blocks.end()) {
+            return found->second;
+        }
+        emp::Integer chain(128, (long long) size, emp::PUBLIC);
+        prf_aes(&(key->bits[8 * PRF_KEY_OFFSET].bit), &chain, 128, party);
+        if (owned >= 0) {
+            length_blocks[{owned, size}] = chain;
+        }
+        return chain;
+    }
 };
 }  // namespace secrets
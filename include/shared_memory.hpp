@@ -4,6 +4,7 @@
 
 #pragma once
 #include <emp-tool/emp-tool.h>
+#include "include/types.h"
 
 #include <boost/interprocess/managed_shared_memory.hpp>
 #include <boost/interprocess/containers/vector.hpp>
@@ -25,7 +26,8 @@ struct SharedData {
 };
 
 void sender(const std::string& semaphore_name, const std::string& managed_shm_name, 
-		const emp::Integer* list, const size_t list_size) {
+		const emp::Integer* list, const size_t list_size,
+		const size_t width = entrybits) {
 	try {
 		// Create or open the shared memory object
 		managed_shared_memory segment(open_or_create, managed_shm_name.c_str(), 655360);
@@ -37,10 +39,10 @@ void sender(const std::string& semaphore_name, const std::string& managed_shm_na
 
 		// Write the emp::Integer values to the shared memory in reverse order
 		emp::block tmp;
-		data->vec.resize(list_size*hashbits);
+		data->vec.resize(list_size*width);
 		size_t k = 0;
 		for (size_t i = 0; i < list_size; i++) {
-			for (size_t j = 0; j < hashbits; j++) {
+			for (size_t j = 0; j < width; j++) {
 				tmp = list[(list_size - 1) - i].bits[j].bit;
 				data->vec[k] = tmp;
 				k = k + 1;
@@ -59,7 +61,8 @@ void sender(const std::string& semaphore_name, const std::string& managed_shm_na
 }
 
 void receiver(const std::string& semaphore_name, const std::string& managed_shm_name,
-		emp::Integer* list, const size_t list_size) {
+		emp::Integer* list, const size_t list_size,
+		const size_t width = entrybits) {
 	while (true) {
 		try {
 			// Open the named semaphore
@@ -84,10 +87,10 @@ void receiver(const std::string& semaphore_name, const std::string& managed_shm_
 			// std::cout << "Receiver: located shared_memory for the data structure SharedData." << std::endl;
 
 			// Get the emp::Integer data from the shared memory
-			emp::Integer tmp_int(hashbits, 0);
+			emp::Integer tmp_int(width, 0);
 			size_t k = 0;
 			for (size_t i = 0; i < list_size; i++) {
-				for (size_t j = 0; j < hashbits; j++) {
+				for (size_t j = 0; j < width; j++) {
 					tmp_int.bits[j].bit = data->vec[k];
 					k = k + 1;
 				}
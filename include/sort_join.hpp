@@ -0,0 +1,112 @@
+// Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org>
+// Author: Roberta De Viti
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <emp-sh2pc/emp-sh2pc.h>
+#include <include/primitives.hpp>
+#include <initializer_list>
+#include <vector>
+
+namespace pathquery {
+
+// How contact() and flow() decide which fetched encounters meet the source / sink sets.
+// BLOOM_FILTER: each fetched encounter is tested against Bloom filters as it is fetched (a scan of a filter per test,
+// with false positives).
+// SORT_JOIN: the fetched (encountered, device, time) tuples are collected, sorted once together with the tagged
+// source / sink ids, and membership is resolved in one linear pass over the sorted list (exact).
+enum class WalkStrategy { BLOOM_FILTER, SORT_JOIN };
+
+// the bits [first, first + size) of x, as an Integer (no gates)
+emp::Integer sub_integer(const emp::Integer & x, const size_t first, const size_t size) {
+  emp::Integer result;
+  result.bits.assign(x.bits.begin() + first, x.bits.begin() + first + size);
+  return result;
+}
+
+// the concatenation of parts, the first in the lowest bits (no gates): in a sort, the last part is compared first
+emp::Integer concat(std::initializer_list<const emp::Integer *> parts) {
+  emp::Integer result;
+  for (const emp::Integer * part : parts) {
+    result.bits.insert(result.bits.end(), part->bits.begin(), part->bits.end());
+  }
+  return result;
+}
+
+// a one-bit Integer (no gates)
+emp::Integer bit_integer(const emp::Bit & bit) {
+  emp::Integer result;
+  result.bits.push_back(bit);
+  return result;
+}
+
+// the number of bits of a public index below count
+size_t index_bits(const size_t count) {
+  size_t bits = 1;
+  while (bits < 64 && (uint64_t(1) << bits) < count) {
+    ++bits;
+  }
+  return bits;
+}
+
+// flag the first element of every run of equal ids in a sorted list: ids are the bits [first, first + size) of keys
+std::vector<emp::Bit> id_heads(const std::vector<emp::Integer> & keys, const size_t first, const size_t size) {
+  std::vector<emp::Bit> heads;
+  heads.reserve(keys.size());
+  if (keys.empty()) {
+    return heads;
+  }
+  heads.emplace_back(emp::Bit(true, emp::PUBLIC));
+  emp::Integer previous = sub_integer(keys[0], first, size);
+  for (size_t r = 1; r < keys.size(); ++r) {
+    emp::Integer id = sub_integer(keys[r], first, size);
+    heads.emplace_back(!(id == previous));
+    previous = id;
+  }
+  return heads;
+}
+
+// the number of distinct groups with at least one hit.
+// sorts (group, !hit) so that a group with a hit starts with one, then counts the heads that are hits.
+emp::Integer count_groups_with_hits(const std::vector<emp::Integer> & groups, const std::vector<emp::Bit> & hits,
+                                    const size_t count_bits = 32) {
+  emp::Integer count(count_bits, 0, emp::PUBLIC);
+  if (groups.empty()) {
+    return count;
+  }
+  const emp::Integer one(count_bits, 1, emp::PUBLIC);
+  const size_t group_bits = groups[0].size();
+  std::vector<emp::Integer> keys(groups.size());
+  for (size_t r = 0; r < groups.size(); ++r) {
+    const emp::Integer no_hit = bit_integer(!hits[r]);
+    keys[r] = concat({&no_hit, &(groups[r])});
+  }
+  emp::sort(keys.data(), (int) keys.size(), (emp::Bit *) nullptr, true);
+  const std::vector<emp::Bit> heads = id_heads(keys, 1, group_bits);
+  for (size_t r = 0; r < keys.size(); ++r) {
+    count = emp::If(heads[r] & !(keys[r].bits[0]), count + one, count);
+  }
+  return count;
+}
+
+// order-preserving compaction of list entries (see primitives.hpp): the valid entries move to the front, in order, and
+// every other slot is left invalid
+void compact_valid(std::vector<emp::Integer> & entries) {
+  if (entries.size() < 2) {
+    return;
+  }
+  const size_t n_bits = floor(log2(entries.size() - 1)) + 1;
+  const emp::Integer zero(n_bits, 0, emp::PUBLIC);
+  const emp::Integer one(n_bits, 1, emp::PUBLIC);
+  emp::Integer count_invalid = zero;
+  std::vector<emp::Integer> distance;
+  distance.reserve(entries.size());
+  for (const emp::Integer & entry : entries) {
+    const emp::Bit invalid = !valid_bit(entry);
+    distance.emplace_back(emp::If(invalid, zero, count_invalid));
+    count_invalid = count_invalid + emp::If(invalid, one, zero);
+  }
+  compact(distance, entries.data(), entries.size());
+}
+
+}  // namespace pathquery
@@ -2,6 +2,7 @@
 
 const int didbits = 256;                        // did bitwidth
 const int hashbits = 32;                        // fingerprint hash bitwidth
+const int entrybits = hashbits + 1;             // list entry: hash + valid bit
 const size_t tilebits = 2 * 256 + 32 + 16 + 8;  // bits of a tile in kvs
 
 
@@ -8,7 +8,8 @@ using namespace std::string_literals;
 
 // reducer equality check parser
 void parse(std::string file, int& party, int& port, std::string& peer_ip_1,
-        std::string& peer_ip_2, size_t* tile_size, std::string* outfile = nullptr) {
+        std::string& peer_ip_2, size_t* tile_size, std::string* outfile = nullptr,
+        int* n_workers = nullptr) {
     // reading JSON file
     FILE* fp = fopen(file.c_str(), "r");
     if (!fp) {
@@ -42,6 +43,8 @@ void parse(std::string file, int& party, int& port, std::string& peer_ip_1,
             *tile_size = options["tile_size"].GetInt();
         if (options.HasMember("outfile"))
             if (outfile != nullptr) *outfile = options["outfile"].GetString();
+        if (options.HasMember("n_workers"))
+            if (n_workers != nullptr) *n_workers = options["n_workers"].GetInt();
     }
 }
 
@@ -289,7 +292,8 @@ void parse(std::string file, bool is_mapper, int& party, int& port,
            int& tile_start, int& tile_end, size_t& tile_size,
            std::string& peer_ip, std::string& mapper_reducer_ip,
            int& reducer_port, std::string& redis_ip, uint16_t* redis_port,
-           int& n_reps, std::string& outfile) {
+           int& n_reps, std::string& outfile, int* n_workers = nullptr,
+           int* pool_session = nullptr) {
     // reading JSON file
     FILE* fp = fopen(file.c_str(), "r");
     if (!fp) {
@@ -335,6 +339,11 @@ void parse(std::string file, bool is_mapper, int& party, int& port,
         if (options.HasMember("n_reps")) n_reps = options["n_reps"].GetInt();
         if (options.HasMember("outfile"))
             outfile = options["outfile"].GetString();
+        if (options.HasMember("n_workers"))
+            if (n_workers != nullptr) *n_workers = options["n_workers"].GetInt();
+        if (options.HasMember("pool_session"))
+            if (pool_session != nullptr)
+                *pool_session = options["pool_session"].GetInt();
         if (is_mapper) {
             if (options.HasMember("reducer_ip"))
                 mapper_reducer_ip = options["reducer_ip"].GetString();
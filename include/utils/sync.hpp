@@ -0,0 +1,33 @@
+// Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org>
+// Author: Roberta De Viti
+// SPDX-License-Identifier: MIT
+
+#pragma once
+#include <emp-tool/emp-tool.h>
+
+// Both parties of a path query run the same deterministic sequence of 2PC
+// operations over an ordered NetIO stream, so they need no barrier to stay
+// in step: only data still sitting in the send buffer when a party blocks on
+// something else (a SwappableRam swap, the equality checker) must be flushed.
+// Build with DEBUG_SYNC (cmake -DDEBUG_SYNC=ON) to put a full sync() round
+// trip at each of these points, which keeps debug printouts of both parties
+// in step.
+
+// a barrier only in DEBUG_SYNC builds
+inline void debug_sync(emp::NetIO* io) {
+#ifdef DEBUG_SYNC
+    io->sync();
+#else
+    (void)io;
+#endif
+}
+
+// send what is buffered before blocking on something other than io
+// (a barrier in DEBUG_SYNC builds)
+inline void flush_before_wait(emp::NetIO* io) {
+#ifdef DEBUG_SYNC
+    io->sync();
+#else
+    io->flush();
+#endif
+}
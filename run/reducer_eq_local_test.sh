@@ -0,0 +1,63 @@
+#!/bin/bash
+# Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org>
+# Author: Roberta De Viti
+# SPDX-License-Identifier: MIT
+#
+# This script runs both parties of the reducer_eq program on localhost and
+# checks that the equality check passes on both sides.
+# Build with -DTHREADING=on (as setup.sh does) to test the threaded
+# dual-ex path, without it to test the fork-based one.
+# Usage: ./run/reducer_eq_local_test.sh [tile_size] [n_workers]
+
+tile_size=${1:-100}
+n_workers=${2:-1}
+port=50000
+tmp_dir=$(mktemp -d)
+
+# cleanup
+pgrep -f "./build/bin/reducer_eq" && sudo pkill -f "./build/bin/reducer_eq"
+
+for party in a b
+do
+	nr=$([[ "${party}" == "a" ]] && echo 1 || echo 2)
+	cat > "${tmp_dir}/reducer_eq_${party}.json" <<EOF
+{
+    "description": "Reducer Equality Check local test",
+    "options": {
+        "party": ${nr},
+        "peer_ip_1": "127.0.0.1",
+        "peer_ip_2": "127.0.0.1",
+        "port": ${port},
+        "tile_size": ${tile_size},
+        "n_workers": ${n_workers},
+        "outfile": "${tmp_dir}/reducer_eq_${party}.csv"
+    }
+}
+EOF
+done
+
+./build/bin/reducer_eq "${tmp_dir}/reducer_eq_a.json" > "${tmp_dir}/a.log" 2>&1 &
+pid_a=$!
+./build/bin/reducer_eq "${tmp_dir}/reducer_eq_b.json" > "${tmp_dir}/b.log" 2>&1 &
+pid_b=$!
+wait ${pid_a}
+status_a=$?
+wait ${pid_b}
+status_b=$?
+
+result=0
+for party in a b
+do
+	if ! grep -q "Result: 1" "${tmp_dir}/${party}.log"; then
+		echo "Error: the equality check did not pass for party ${party}:"
+		cat "${tmp_dir}/${party}.log"
+		result=1
+	fi
+done
+if [[ ${status_a} -ne 0 || ${status_b} -ne 0 ]]; then
+	echo "Error: reducer_eq exited with ${status_a} (a), ${status_b} (b)"
+	result=1
+fi
+[[ ${result} -eq 0 ]] && echo "reducer_eq local test passed."
+rm -rf "${tmp_dir}"
+exit ${result}
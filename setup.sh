@@ -37,7 +37,9 @@ cd emp-tool
 git checkout 6e75f6d03e622ca6a2a23ba0c1c82fdd93f2c733
 # echo "set(CRYPTO_IN_CIRCUIT 1)" >> cmake/emp-base.cmake
 # cmake .
-cmake -DCRYPTO_IN_CIRCUIT=on .
+# THREADING makes the circuit execution thread-local (needed by the
+# parallel sorting sessions in include/parallel_sort.hpp)
+cmake -DCRYPTO_IN_CIRCUIT=on -DTHREADING=on .
 make
 sudo make install
 cd ..
@@ -87,7 +89,7 @@ cd covault
 mkdir build
 cd build
 sudo cp ../cmake/common.cmake /usr/local/cmake/.
-cmake ..
+cmake -DTHREADING=on ..
 make
 echo "Install complete. Setting up Redis."
 
@@ -5,6 +5,7 @@
 // This file contains the code for 1-st stage reducer processing.
 
 #include <sys/wait.h>
+#include "include/parallel_sort.hpp"
 #include "include/reducer.hpp"
 #include "include/utils/parser.hpp"
 #include "include/utils/stats.hpp"
@@ -28,6 +29,8 @@ int main(int argc, char* argv[]) {
     std::string mapper_ip = "127.0.0.1"s;
     int reducer_port = -1;
     int n_reps = 1;
+    int n_workers = 1;
+    int pool_session = 0;
     std::string nullstr = "";
     std::string outfile = "";
     bool malicious = true;
@@ -44,7 +47,8 @@ int main(int argc, char* argv[]) {
 
     // parse input variables
     parse(file, false, party, port, tile_start, tile_end, tile_size, peer_ip,
-          mapper_ip, reducer_port, nullstr, nullptr, n_reps, outfile);
+          mapper_ip, reducer_port, nullstr, nullptr, n_reps, outfile,
+          &n_workers, &pool_session);
 
     size_t output_size = tile_size;
 
@@ -65,16 +69,20 @@ int main(int argc, char* argv[]) {
             party == emp::ALICE ? nullptr : peer_ip.c_str(), port);
 
         emp::setup_semi_honest(io.get(), party, malicious);
+        // extra 2PC sessions to split each sorting network stage across
+        parallel::SessionPool pool(party, peer_ip,
+                                   parallel::pool_port(pool_session, n_workers),
+                                   n_workers, malicious);
 
         emp::Integer* lists = new emp::Integer[tile_size * 2];
-        emp::Integer tmp_int(hashbits, 0);
+        emp::Integer tmp_int(entrybits, 0);
         io->sync();
 
         // if there's more than a list, store new list at pos tile_size
         size_t base_idx = tile_size;
         for (int t = 0; t < n_tiles; t++) {
             for (size_t i = 0; i < tile_size; i++) {
-                for (size_t j = 0; j < hashbits; j++) {
+                for (size_t j = 0; j < entrybits; j++) {
                     mrio.recv_block(&tmp_int.bits[j].bit, 1);
                     // std::cout << (party == emp::ALICE ? "(gen) " : "(eva) ")
                     // << "Got: " << i << ": " << j << std::endl;
@@ -88,15 +96,15 @@ int main(int argc, char* argv[]) {
             // we sort the list in [0, tile_size] ascending, and the list in
             // [tile_size, 2*tile_size] descending to have a final
             // descending order
-            emp::sort(&lists[base_idx], tile_size, (Bit*)nullptr,
-                      base_idx == 0 ? true : false);
+            parallel::sort(pool, &lists[base_idx], tile_size, (Bit*)nullptr,
+                           base_idx == 0 ? true : false);
 
             // if more than one list has been processed so far, merge results
             if (t > 0) {
-                // merge sort in final descending order, with junk at the
-                // beginning
-                emp::bitonic_merge(lists, (Bit*)nullptr, 0, tile_size * 2,
-                                   false);
+                // merge sort in final descending order, with invalid
+                // entries (none_entry(), the smallest) at the end
+                parallel::bitonic_merge(pool, lists, (Bit*)nullptr, 0,
+                                        tile_size * 2, false);
             }
             // consider lists[tile_size, 2*tile_size] as the
             // current list, which is already sorted in the descending order
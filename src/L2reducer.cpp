@@ -5,6 +5,7 @@
 // This file contains the code for i-th stage reducer processing.
 
 #include <sys/wait.h>
+#include "include/parallel_sort.hpp"
 #include "include/reducer.hpp"
 #include "include/utils/parser.hpp"
 #include "include/utils/stats.hpp"
@@ -28,12 +29,15 @@ void reduce(std::string file, bool malicious = true) {
     std::string mapper_ip = "127.0.0.1"s;
     int reducer_port = -1;
     int n_reps = 1;
+    int n_workers = 1;
+    int pool_session = 0;
     std::string nullstr = "";
     std::string outfile = "";
 
     // parse input variables
     parse(file, false, party, port, tile_start, tile_end, tile_size, peer_ip,
-          mapper_ip, reducer_port, nullstr, nullptr, n_reps, outfile);
+          mapper_ip, reducer_port, nullstr, nullptr, n_reps, outfile,
+          &n_workers, &pool_session);
 
     size_t output_size = tile_size;
     int n_tiles = tile_end - tile_start + 1;
@@ -63,16 +67,20 @@ void reduce(std::string file, bool malicious = true) {
             party == emp::ALICE ? nullptr : peer_ip.c_str(), port);
 
         emp::setup_semi_honest(io.get(), party, malicious);
+        // extra 2PC sessions to split each sorting network stage across
+        parallel::SessionPool pool(party, peer_ip,
+                                   parallel::pool_port(pool_session, n_workers),
+                                   n_workers, malicious);
 
         emp::Integer* lists = new emp::Integer[tile_size * 2];
-        emp::Integer tmp_int(hashbits, 0);
+        emp::Integer tmp_int(entrybits, 0);
         io->sync();
 
         // if there's more than a list, store new list at pos tile_size
         size_t base_idx = tile_size;
         for (int t = 0; t < n_tiles; t++) {
             for (size_t i = 0; i < tile_size; i++) {
-                for (size_t j = 0; j < hashbits; j++) {
+                for (size_t j = 0; j < entrybits; j++) {
                     mrio.recv_block(&tmp_int.bits[j].bit, 1);
                     // std::cout << (party == emp::ALICE ? "(gen) " : "(eva) ")
                     // << "Got: " << i << ": " << j << std::endl;
@@ -87,7 +95,9 @@ void reduce(std::string file, bool malicious = true) {
             // descending order
             // emp::sort(&lists[base_idx], tile_size, (Bit*)nullptr,
             //          base_idx == 0 ? true : false);
-            // new model: input is sorted, we just flip the second list
+            // new model: input is sorted descending and compacted
+            // ([valid | none]), we just flip it to ascending (none is the
+            // smallest entry)
             emp::Integer tmp;
             for (size_t low = 0, high = tile_size - 1; low < high;
                  low++, high--) {
@@ -98,10 +108,10 @@ void reduce(std::string file, bool malicious = true) {
 
             // if more than one list has been processed so far, merge results
             if (t > 0) {
-                // merge sort in final descending order, with junk at the
-                // beginning
-                emp::bitonic_merge(lists, (Bit*)nullptr, 0, tile_size * 2,
-                                   false);
+                // merge sort in final descending order, with invalid
+                // entries (none_entry(), the smallest) at the end
+                parallel::bitonic_merge(pool, lists, (Bit*)nullptr, 0,
+                                        tile_size * 2, false);
             }
             // consider lists[tile_size, 2*tile_size] as the
             // current list, which is already sorted in the descending order
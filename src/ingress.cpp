@@ -5,6 +5,7 @@
 // This file contains the code for ingress processing.
 
 #include "include/encounter.hpp"
+#include "include/permutation.hpp"
 #include "include/redis.h"
 #include "include/utils/parser.hpp"
 #include "include/utils/stats.hpp"
@@ -299,9 +300,11 @@ int main(int argc, char** argv) {
             double t_garble = duration(time_now() - start);
 #endif
 
-            // sort the tile according to the encounter id
+            // sort the tile according to the encounter id: only the
+            // (id, index) pairs go through the sorting network, the tiles
+            // are moved once by a secret shuffle
             start = time_now();
-            emp::sort(sort_key, tile_size, tile, true);
+            permutation::sort_by_index(sort_key, tile_size, tile, party, true);
             double t_sort = duration(time_now() - start);
 
             // check encounter id duplicates and set validity bit.
@@ -107,7 +107,7 @@ void map(std::string file, bool switch_roles = false, bool malicious = false) {
             }
             double r_elapsed = duration(time_now() - r_start);
             double loop_bw =
-                ((tile_size * hashbits * 128) / r_elapsed) * 1e-9;  // Gbps
+                ((tile_size * entrybits * 128) / r_elapsed) * 1e-9;  // Gbps
             // store peak bw
             if (mr_bw < loop_bw) {
                 mr_bw = loop_bw;
@@ -139,7 +139,7 @@ void map(std::string file, bool switch_roles = false, bool malicious = false) {
         fout << tile_size << "," << elapsed << "," << gates << ","
              << float(bytes / 1000.0) << "," << std::get<0>(ts_bw) << ","
              << std::get<1>(ts_bw) << ","
-             << float((tile_size * hashbits * 128) / (8.0 * 1000.0)) << ","
+             << float((tile_size * entrybits * 128) / (8.0 * 1000.0)) << ","
              << max_elapsed << "," << mr_bw << std::endl;
         fout.close();
     }
@@ -0,0 +1,118 @@
+// Copyright (c) 2025 Roberta De Viti <rdeviti-at-mpi-sws.org>
+// Author: Roberta De Viti
+// SPDX-License-Identifier: MIT
+//
+// This file contains the code for a reducer node of a reduction tree of any
+// depth and fan-in (see include/reduction_tree.hpp and
+// bench/generate_reduction_tree_bench.py).
+
+#include "include/reduction_tree.hpp"
+#include "include/utils/stats.hpp"
+
+namespace {
+void usage(char const* bin) {
+    std::cerr << "Usage: " << bin << " -h\n";
+    std::cerr << "       " << bin << " [JSON file (absolute path)]\n";
+    std::exit(-1);
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    // parsing input variable
+    std::string file;
+    if (argc == 1 && argv[1] == "-h"s) {
+        usage(argv[0]);
+    } else if (argc == 2) {
+        file = argv[1];
+    } else {
+        usage(argv[0]);
+    }
+
+    reduction::TreeNode node;
+    reduction::parse(file, node);
+    bool malicious = true;
+
+    // rerun for nreps times
+    for (int r = 0; r < node.n_reps; r++) {
+        auto start = time_now();
+        // start listening for each upstream
+        std::vector<std::unique_ptr<emp::NetIO>> upstream_io;
+        for (auto& u : node.upstream)
+            upstream_io.emplace_back(new emp::NetIO(nullptr, u.port));
+
+        // setup 2pc
+        auto io = std::make_unique<emp::NetIO>(
+            node.party == emp::ALICE ? nullptr : node.peer_ip.c_str(),
+            node.port);
+        emp::setup_semi_honest(io.get(), node.party, malicious);
+        // extra 2PC sessions to split each sorting network stage across
+        parallel::SessionPool pool(
+            node.party, node.peer_ip,
+            parallel::pool_port(node.pool_session, node.n_workers),
+            node.n_workers, malicious);
+        io->sync();
+
+        // get all the lists, sorting those that come from mappers, and
+        // merge, mark duplicates, compact, cut at output_size: either each
+        // list as soon as it arrives (streaming) or all of them at the end
+        double t_get_sort = duration(time_now() - start);
+        double t_reduce = 0.0;
+        std::vector<emp::Integer> list;
+        if (node.streaming) {
+            reduction::Window window(node.output_size);
+            for (size_t u = 0; u < node.upstream.size(); u++) {
+                for (size_t l = 0; l < node.upstream[u].n_lists; l++) {
+                    start = time_now();
+                    std::vector<emp::Integer> run = reduction::receive_run(
+                        pool, *upstream_io[u], node.upstream[u]);
+                    t_get_sort += duration(time_now() - start);
+                    start = time_now();
+                    window.add(pool, run);
+                    t_reduce += duration(time_now() - start);
+                }
+            }
+            list = window.result();
+        } else {
+            start = time_now();
+            std::vector<std::vector<emp::Integer>> runs;
+            runs.reserve(node.n_lists());
+            for (size_t u = 0; u < node.upstream.size(); u++)
+                for (size_t l = 0; l < node.upstream[u].n_lists; l++)
+                    runs.push_back(reduction::receive_run(
+                        pool, *upstream_io[u], node.upstream[u]));
+            t_get_sort += duration(time_now() - start);
+
+            start = time_now();
+            list = reduction::reduce(pool, runs, node.output_size);
+            t_reduce = duration(time_now() - start);
+        }
+
+        // pass the result on to the next layer
+        start = time_now();
+        if (!node.is_root()) {
+            emp::NetIO downstream_io(node.downstream_ip.c_str(),
+                                     node.downstream_port);
+            reduction::send_run(downstream_io, list);
+        }
+        double t_send = duration(time_now() - start);
+
+        /*
+        // check list
+        for (size_t j = 0; j < list.size(); j++) {
+                std::cout << "Element " << j << ": " <<
+                list[j].reveal<int32_t>() << std::endl;
+        }
+        */
+
+        // raw values
+        std::ofstream fout;
+        fout.open(node.outfile, std::ios::app);
+        fout << node.upstream.size() << "," << node.n_lists() << ","
+             << node.output_size << "," << (t_get_sort + t_reduce + t_send)
+             << "," << t_get_sort << "," << t_reduce << "," << t_send
+             << std::endl;
+        fout.close();
+    }  // end n_reps
+
+    return 0;
+}
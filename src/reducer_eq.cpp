@@ -4,18 +4,26 @@
 //
 // This file contains the code for the last-stage reducer, including the equality check.
 
-#include <emp-tool/circuits/sha3_256.h>
+#include <array>
+#ifndef THREADING
 #include <sys/wait.h>
-#include <boost/interprocess/allocators/allocator.hpp>
-#include <boost/interprocess/containers/string.hpp>
 #include <boost/interprocess/managed_shared_memory.hpp>
+#include <boost/interprocess/sync/interprocess_semaphore.hpp>
+#endif
 #include "include/dualex/ag2pc_wrapper.h"
 #include "include/dualex/labels.h"
+#ifdef THREADING
+#include "include/dualex/runner.h"
+#endif
+#include "include/embedded_circuits.hpp"
+#include "include/parallel_sort.hpp"
 #include "include/reducer.hpp"
 #include "include/utils/parser.hpp"
 #include "include/utils/stats.hpp"
 
+#ifndef THREADING
 using namespace boost::interprocess;
+#endif
 using namespace std::string_literals;
 
 namespace {
@@ -26,22 +34,86 @@ void usage(char const* bin) {
 }
 }  // namespace
 
-namespace ipc {
-typedef allocator<char, managed_shared_memory::segment_manager> CharAllocator;
-typedef basic_string<char, std::char_traits<char>, CharAllocator> string;
-}  // namespace ipc
+typedef std::array<uint8_t, LabelHash::DIGEST_SIZE> Digest;
+
+#ifdef THREADING
+// what the three roles on this machine (round 1, the role-swapped round 2
+// and the equality checker, each on its own thread) hand to each other
+struct Rendezvous {
+    // the evaluator's output bits, for the generator of the other round
+    dualex::Channel<std::vector<uint8_t>> bits;
+    // each round's digest, for the equality checker
+    dualex::Channel<Digest> digest_r1;
+    dualex::Channel<Digest> digest_r2;
+};
+
+void hand_over_bits(Rendezvous& shared, std::vector<uint8_t> v) {
+    shared.bits.push(std::move(v));
+}
+
+std::vector<uint8_t> take_bits(Rendezvous& shared) {
+    return shared.bits.pop();
+}
+
+void hand_over_digest(Rendezvous& shared, bool switch_roles,
+                      const Digest& digest) {
+    (switch_roles ? shared.digest_r2 : shared.digest_r1).push(digest);
+}
+
+Digest take_digest(Rendezvous& shared, bool switch_roles) {
+    return (switch_roles ? shared.digest_r2 : shared.digest_r1).pop();
+}
+#else
+// without THREADING the circuit execution is global to the process, so the
+// role-swapped round 2 runs in a forked child: the same hand-over, through
+// shared memory
+struct Rendezvous {
+    boost::interprocess::interprocess_semaphore bits_ready;
+    boost::interprocess::interprocess_semaphore digest_r1_ready;
+    boost::interprocess::interprocess_semaphore digest_r2_ready;
+    Digest digest_r1;
+    Digest digest_r2;
+    // n_bytes, in the same shared memory segment
+    uint8_t* bits = nullptr;
+    size_t n_bytes = 0;
+
+    Rendezvous() : bits_ready(0), digest_r1_ready(0), digest_r2_ready(0) {}
+};
+
+void hand_over_bits(Rendezvous& shared, std::vector<uint8_t> v) {
+    memcpy(shared.bits, v.data(), std::min(v.size(), shared.n_bytes));
+    shared.bits_ready.post();
+}
+
+std::vector<uint8_t> take_bits(Rendezvous& shared) {
+    shared.bits_ready.wait();
+    return std::vector<uint8_t>(shared.bits, shared.bits + shared.n_bytes);
+}
+
+void hand_over_digest(Rendezvous& shared, bool switch_roles,
+                      const Digest& digest) {
+    (switch_roles ? shared.digest_r2 : shared.digest_r1) = digest;
+    (switch_roles ? shared.digest_r2_ready : shared.digest_r1_ready).post();
+}
+
+Digest take_digest(Rendezvous& shared, bool switch_roles) {
+    (switch_roles ? shared.digest_r2_ready : shared.digest_r1_ready).wait();
+    return switch_roles ? shared.digest_r2 : shared.digest_r1;
+}
+#endif
 
 std::vector<double> reduce(std::string file, bool switch_roles,
-                           uint64_t* s = nullptr, bool* b = nullptr,
-                           bool malicious = false) {
+                           Rendezvous& shared, bool malicious = false) {
     int party = -1;
     int port = -1;
     size_t tile_size = -1;
+    int n_workers = 1;
     std::string peer_ip_1 = "127.0.0.1"s;
     std::string peer_ip_2 = "127.0.0.1"s;
 
     // parse input variables
-    parse(file, party, port, peer_ip_1, peer_ip_2, &tile_size);
+    parse(file, party, port, peer_ip_1, peer_ip_2, &tile_size, nullptr,
+          &n_workers);
 
     // switch parties for second dual-ex runs
     std::string peer_ip = peer_ip_1;
@@ -59,6 +131,12 @@ std::vector<double> reduce(std::string file, bool switch_roles,
         party == emp::ALICE ? nullptr : peer_ip.c_str(), port);
 
     emp::setup_semi_honest(io.get(), party, malicious);
+    // extra 2PC sessions to split each sorting network stage across (one
+    // pool session per round)
+    parallel::SessionPool pool(party, peer_ip,
+                               parallel::pool_port(switch_roles ? 1 : 0,
+                                                   n_workers),
+                               n_workers, malicious);
     double t_setup = duration(time_now() - t_start);
 
     // pre-processing: generate dummy intermediate results
@@ -71,23 +149,24 @@ std::vector<double> reduce(std::string file, bool switch_roles,
     A.reserve(2 * tile_size);
     B.reserve(2 * tile_size);
     for (size_t i = 0; i < 2 * tile_size; i++) {
-        A.emplace_back(Integer(32, int(i), emp::ALICE));
+        A.emplace_back(Integer(hashbits, int(i), emp::ALICE));
     }
     for (size_t i = 0; i < 2 * tile_size; i++) {
-        B.emplace_back(Integer(32, 0, emp::BOB));
+        B.emplace_back(Integer(hashbits, 0, emp::BOB));
     }
+    const emp::Bit valid(1, emp::PUBLIC);
     for (size_t i = 0; i < 2 * tile_size; i++) {
         if (i < tile_size) {
-            list_1.emplace_back(A[i] ^ B[i]);
+            list_1.emplace_back(make_entry(A[i] ^ B[i], valid));
         } else {
-            list_2.emplace_back(A[i] ^ B[i]);
+            list_2.emplace_back(make_entry(A[i] ^ B[i], valid));
         }
     }
 
     // pre-processing assumption: the intermediate results are already
     // sorted
-    emp::sort(&list_1[0], tile_size, (Bit*)nullptr, true);
-    emp::sort(&list_2[0], tile_size, (Bit*)nullptr, true);
+    parallel::sort(pool, &list_1[0], tile_size, (Bit*)nullptr, true);
+    parallel::sort(pool, &list_2[0], tile_size, (Bit*)nullptr, true);
 
     // concatenate lists
     t_start = time_now();
@@ -96,7 +175,8 @@ std::vector<double> reduce(std::string file, bool switch_roles,
     }
 
     // merge
-    emp::bitonic_merge(&list_1[0], (Bit*)nullptr, 0, 2 * tile_size, false);
+    parallel::bitonic_merge(pool, &list_1[0], (Bit*)nullptr, 0, 2 * tile_size,
+                            false);
 
     // compute distance + remove duplicates, compact
     std::vector<emp::Integer> distance =
@@ -111,43 +191,31 @@ std::vector<double> reduce(std::string file, bool switch_roles,
     // io->sync();
 
     t_start = time_now();
-    // generator values
-    emp::block* labels_W = new emp::block[tile_size * hashbits];
-    if (party == emp::ALICE) {
+    // both parties reveal the output bits v to the evaluator, then hash
+    // their side of the equality check while reading the labels: the
+    // evaluator hashes its output labels w and hands v over to the
+    // generator of the other round, which hashes its labels W(v).
+    // note: these are w_1/v_1 and W_1 if switch_roles == false, w_2/v_2 and
+    // W_2 otherwise
+    const size_t n_bytes = (tile_size * entrybits + 7) / 8;
+    std::vector<uint8_t> v(n_bytes);
+    LabelBuffers buffers;
+    reveal_packed_bools(v.data(), &list_1[0], tile_size, emp::BOB, buffers);
+    LabelHash hash;
+    if (party == emp::BOB) {
+        hash_labels(hash, buffers, &list_1[0], tile_size, v.data());
+        hand_over_bits(shared, std::move(v));
+    } else {
         emp::HalfGateGen<emp::NetIO>* t =
             dynamic_cast<emp::HalfGateGen<emp::NetIO>*>(
                 CircuitExecution::circ_exec);
-        get_labels(&list_1[0], tile_size, labels_W, t->delta);
-    }
-
-    // note: these are W_1, w_1 and v_1 if switch_roles == false, W_2,
-    // w_2 and v_2 otherwise
-    // evaluator values
-    uint64_t* labels_w = new uint64_t[tile_size * hashbits];
-    bool* bools_v = new bool[tile_size * hashbits];
-    // note: this is all 0s for alice, no need to pass delta
-    reveal_labels_and_bools(labels_w, bools_v, &list_1[0], tile_size, emp::BOB);
-
-    // if this is the child process, s and b point to shared memory segments,
-    // otherwise, s and b point to arrays
-    if (party == emp::ALICE) {
-        uint64_t* tmp = nullptr;
-        for (size_t i = 0; i < tile_size * hashbits; i++) {
-            tmp = (uint64_t*)(&labels_W[i]);
-            *(s + 2 * i) = tmp[0];      // first 64-bit block
-            *(s + 2 * i + 1) = tmp[1];  // second 64-bit block
-        }
-    } else {
-        uint64_t* tmp = nullptr;
-        for (size_t i = 0; i < tile_size * hashbits; i++) {
-            tmp = (uint64_t*)(&labels_w[i]);
-            *(s + 2 * i) = tmp[0];      // first 64-bit block
-            *(s + 2 * i + 1) = tmp[1];  // second 64-bit block
-        }
-        for (size_t i = 0; i < tile_size * hashbits; i++) {
-            *(b + i) = bools_v[i];
-        }
+        v = take_bits(shared);
+        hash_labels(hash, buffers, &list_1[0], tile_size, v.data(),
+                    &t->delta);
     }
+    Digest digest;
+    hash.digest(digest.data());
+    hand_over_digest(shared, switch_roles, digest);
 
     double t_labels = duration(time_now() - t_start);
 
@@ -156,88 +224,12 @@ std::vector<double> reduce(std::string file, bool switch_roles,
     return times;
 }
 
-bool equality_check(uint64_t* W_1_v_2, uint64_t* w_2, uint64_t* W_2_v_1,
-                    uint64_t* w_1, int party, int port, std::string peer_ip,
-                    size_t tile_size) {
-    // setup 2pc for equality check
-    auto io = std::make_unique<emp::NetIO>(
-        party == emp::ALICE ? nullptr : peer_ip.c_str(), port + 1000);
-    emp::setup_semi_honest(io.get(), party);
-
-    // note: DIGEST_SIZE in bits for Bool array
-    bool input[emp::Hash::DIGEST_SIZE * 8];
-    // note: the hash is 256 bits (8*32)
-    uint8_t hash_value[emp::Hash::DIGEST_SIZE];
-
-    // parent generator: generate hash h1 = (w_2 || W_1(v_2))
-    if (party == emp::ALICE) {
-        // rewrite w_2 to skip the second in every pair of its labels
-        // this is because it has the same length as W but only half
-        // the information (only 1 label per bit instead of 2 because
-        // it's the output wires)
-        // e.g., currently w_2 = [1234, 5678, 5678, 9012, 9012, ...]
-        // should read [1234, 5678, 9012, ...]
-        for (size_t i = 0; i < tile_size * hashbits; i++) {
-            w_2[i] = w_2[2 * i];
-            // std::cout << "w2[" << i << "]:\t" << w_2[i] << std::endl;
-        }
-
-        // W1(v2) is the second half of h1
-        // for(size_t i=0; i < 2*tile_size*hashbits; i=i+2)
-        //    std::cout << "W1(v2)[" << i << "]:\t" << W_1_v_2[i] << std::endl;
-
-        // concatenate (w_2 || W_1(v_2)) to get the value to hash
-        uint64_t* concat = new uint64_t[2 * tile_size * hashbits];
-        size_t k = 0;
-        for (size_t i = 0; i < tile_size * hashbits; i++) {
-            concat[k] = w_2[i];
-            k = k + 1;
-        }
-        for (size_t i = 0; i < tile_size * hashbits; i++) {
-            concat[k] = W_1_v_2[i];
-            k = k + 1;
-        }
-
-        // hash to get h1
-        emp::sha3_256<uint64_t>(hash_value, concat, 2 * tile_size * hashbits);
-        // for (size_t i = 0; i < emp::Hash::DIGEST_SIZE*8; ++i)
-        // 	std::cout << std::setfill('0') << std::setw(2) << std::hex << ((int)
-        // hash_value[i]) << " "; std::cout << std::endl << std::flush;
-    }
-
-    // parent evaluator: generate hash h2 = (W_2(v_1) || w_1)
-    if (party == emp::BOB) {
-        // rewrite w_1 as well to skip the second in every pair of its labels
-        for (size_t i = 0; i < tile_size * hashbits; i++) {
-            w_1[i] = w_1[2 * i];
-            // std::cout << "w1[" << i << "]:\t" << w_1[i] << std::endl;
-        }
-        // W2(v1) is the first half of h2
-        // for(size_t i=0; i < 2*tile_size*hashbits; i=i+2)
-        // std::cout << "W2(v1)[" << i << "]:\t" << W_2_v_1[i] << std::endl;
-
-        // concatenate (W_2(v_1) || w_1) to get the value to hash
-        uint64_t* concat = new uint64_t[2 * tile_size * hashbits];
-        size_t k = 0;
-        for (size_t i = 0; i < tile_size * hashbits; i++) {
-            concat[k] = W_2_v_1[i];
-            k = k + 1;
-        }
-        for (size_t i = 0; i < tile_size * hashbits; i++) {
-            concat[k] = w_1[i];
-            k = k + 1;
-        }
-
-        // hash to get h2
-        emp::sha3_256<uint64_t>(hash_value, concat, 2 * tile_size * hashbits);
-        // for (size_t i = 0; i < emp::Hash::DIGEST_SIZE*8; ++i)
-        //	std::cout << std::setfill('0') << std::setw(2) << std::hex << ((int)
-        //hash_value[i]) << " ";
-        // std::cout << std::endl << std::flush;
-    }
-
+// the equality check on the combined digest: only the online phase of the
+// pre-processed instance is left on the critical path
+bool equality_check(EqCheckPool& pool, const uint8_t* hash_value) {
     // cast hash_value (vector of uint8_t) to input (vector of bools)
-    to_bool<uint8_t>(input, hash_value, emp::Hash::DIGEST_SIZE * 8);
+    bool input[LabelHash::DIGEST_SIZE * 8];
+    to_bool<uint8_t>(input, hash_value, LabelHash::DIGEST_SIZE * 8);
 
     // sanity check: should be the same for parent generator and evaluator!
     // this is the value they will input in the equality check
@@ -249,12 +241,38 @@ bool equality_check(uint64_t* W_1_v_2, uint64_t* w_2, uint64_t* W_2_v_1,
     std::cout << std::endl;
     */
 
-    // sync and run maliciously-secure equality check circuit
-    io->sync();
-    std::string circuit_filename =
-        "eq" + std::to_string(emp::Hash::DIGEST_SIZE * 8) + ".txt";
-    return maliciously_secure_equality_check(party, input, io.get(),
-                                             circuit_filename);
+    // run maliciously-secure equality check circuit
+    return pool.check(input);
+}
+
+// eq256: LabelHash::DIGEST_SIZE * 8 input bits per party
+std::shared_ptr<emp::BristolFormat> eq_circuit() {
+    return std::make_shared<emp::BristolFormat>(
+        circuits::load(circuits::eq256));
+}
+
+// waits for both rounds' digests, combines them and runs the equality check
+bool check_digests(EqCheckPool& pool, Rendezvous& shared,
+                   double& t_apply_labels, double& t_check) {
+    Digest digest_r2 = take_digest(shared, true);
+    Digest digest_r1 = take_digest(shared, false);
+    std::cout << "Dual-ex reduce operations done." << std::endl;
+
+    auto t_start = time_now();
+    // generator of round 1: h1 = H(H(w_2) || H(W_1(v_2)))
+    // evaluator of round 1: h2 = H(H(W_2(v_1)) || H(w_1))
+    uint8_t hash_value[LabelHash::DIGEST_SIZE];
+    LabelHash hash;
+    hash.put(digest_r2.data(), LabelHash::DIGEST_SIZE);
+    hash.put(digest_r1.data(), LabelHash::DIGEST_SIZE);
+    hash.digest(hash_value);
+    t_apply_labels = duration(time_now() - t_start);
+
+    std::cout << "Pre-processing done. Running equality check." << std::endl;
+    t_start = time_now();
+    bool result = equality_check(pool, hash_value);
+    t_check = duration(time_now() - t_start);
+    return result;
 }
 
 int main(int argc, char* argv[]) {
@@ -276,115 +294,82 @@ int main(int argc, char* argv[]) {
     std::string outfile = "";
     parse(file, party, port, peer_ip_1, peer_ip_2, &tile_size, &outfile);
 
-    // use first peer_ip for parent processes
+    // the equality check uses the first peer_ip, as round 1
     std::string peer_ip = peer_ip_1;
 
     auto t_start = time_now();
-    // initialize shared memory objects to store results of round 2 (children
-    // processes)
-    shared_memory_object::remove("BoostLabels");
-    shared_memory_object::remove("BoostBools");
-    managed_shared_memory managed_shm_labels{
-        open_or_create, "BoostLabels",
-        100 * hashbits * tile_size * sizeof(emp::block)};
-    managed_shared_memory managed_shm_bools{open_or_create, "BoostBools",
-                                            100 * hashbits * tile_size};
-    uint64_t* labels_r2 = managed_shm_labels.construct<uint64_t>("Integer")(0);
-    bool* bools_r2 = managed_shm_bools.construct<bool>("Bool")(0);
-
-    // pointers to store results of round 1 (parent processes)
-    uint64_t* labels_r1 = new uint64_t[100 * tile_size * hashbits];
-    bool* bools_r1 = new bool[tile_size * hashbits];
-
+#ifdef THREADING
+    // round 1, the role-swapped round 2 and the equality check run on
+    // threads, each with its own 2PC session: only the evaluator's output
+    // bits and the two digests cross between them
+    Rendezvous shared;
+#else
+    // round 2 runs in a forked child: the rendezvous and the evaluator's
+    // output bits live in shared memory
+    const size_t n_bytes = (tile_size * entrybits + 7) / 8;
+    shared_memory_object::remove("BoostDualEx");
+    managed_shared_memory managed_shm{open_or_create, "BoostDualEx",
+                                      sizeof(Rendezvous) + n_bytes + 4096};
+    Rendezvous& shared = *managed_shm.construct<Rendezvous>("Rendezvous")();
+    shared.bits = managed_shm.construct<uint8_t>("Bits")[n_bytes](0);
+    shared.n_bytes = n_bytes;
+#endif
     double t_setup = duration(time_now() - t_start);
     std::vector<double> reduce_times;
+    double t_apply_labels = 0.0;
+    double t_check = 0.0;
+    bool result = false;
+
+#ifdef THREADING
+    dualex::run_roles({
+        [&] { reduce_times = reduce(file, false, shared, true); },
+        [&] { reduce(file, true, shared, true); },
+        [&] {
+            // pre-process the equality check while the rounds run
+            EqCheckPool pool(party, peer_ip, port + 1000, eq_circuit(), 1, 1);
+            result = check_digests(pool, shared, t_apply_labels, t_check);
+        },
+    });
+#else
     pid_t pid = fork();
-    int status;
-
     if (pid < 0) {
         std::cerr << "Error: failed to fork." << std::endl;
         std::exit(1);
     }
-    if (pid == 0)
-        reduce(file, true, labels_r2, bools_r2, true);
-    else {
-        reduce_times = reduce(file, false, labels_r1, bools_r1, true);
-        wait(&status);
-        printf("End of process %d: ", pid);
-        if (WIFEXITED(status)) {
-            printf("The process ended with exit(%d).\n", WEXITSTATUS(status));
-        }
-        if (WIFSIGNALED(status)) {
-            printf("The process ended with kill -%d.\n", WTERMSIG(status));
-        }
-
-        // check
-        std::cout << "Dual-ex reduce operations done." << std::endl;
-        std::cout << "Starting equality check pre-processing." << std::endl;
-        std::cout << "Labels: " << labels_r1 << "\t" << *labels_r2 << "\t"
-                  << bools_r1 << "\t" << *bools_r2 << std::endl;
-
-        t_start = time_now();
-        // parent generator (all zeros otherwise)
-        // h1 = (w_2 || W_1(v_2))
-        uint64_t* W_1_v_2 = new uint64_t[tile_size * hashbits];
-        // print only for parent generator (not meaningful otherwise)
-        if (party == emp::ALICE) {
-            /*
-               std::cout << "----- W1 -----\n";
-               for(size_t i=0; i < 2*tile_size*hashbits; i=i+2)
-               std::cout << "W1[" << i/2 << "]:\t" << labels_r1[i] << "\t"
-               << labels_r1[i+1] << std::endl; std::cout << "----- v2 -----\n";
-               for(size_t i=0; i < tile_size*hashbits; i++)
-               std::cout << "v2[" << i << "]:\t" << bools_r2[i] <<
-               std::endl;
-             */
-            apply_labels(W_1_v_2, labels_r1, bools_r2, tile_size, hashbits);
-        }
-
-        // parent evaluator (all zeros otherwise)
-        // h2 = (W_2(v_1) || w_1)
-        uint64_t* W_2_v_1 = new uint64_t[tile_size * hashbits];
-        // print only for parent evaluator (not meaningful otherwise)
-        if (party == emp::BOB) {
-            /*
-               std::cout << "----- W2 -----\n";
-               for(size_t i=0; i < tile_size*hashbits; i++)
-               std::cout << "W2[" << i/2 << "]:\t" << labels_r2[i] << "\t"
-               << labels_r2[i+1] << std::endl; std::cout << "----- v1 -----\n";
-               for(size_t i=0; i < tile_size*hashbits; i++)
-               std::cout << "v1[" << i << "]:\t" << bools_r1[i] <<
-               std::endl;
-             */
-            apply_labels(W_2_v_1, labels_r2, bools_r1, tile_size, hashbits);
-        }
-        double t_apply_labels = duration(time_now() - t_start);
-
-        // note: w_1 and w_2 are in labels_r1 and labels_r2, when the party
-        // writing it down is the evaluator! (otherwise it contains W_1 and
-        // W_2)
-        std::cout << "Pre-processing done. Running equality check."
-                  << std::endl;
-        t_start = time_now();
-        bool result = equality_check(W_1_v_2, labels_r2, W_2_v_1, labels_r1,
-                                     party, port, peer_ip, tile_size);
-        double t_check = duration(time_now() - t_start);
-        std::cout << "Result: " << result << " (1: true, 0: false)."
-                  << std::endl;
-
-        double t_total_time =
-            t_setup + t_apply_labels + t_check +
-            std::accumulate(reduce_times.begin(), reduce_times.end(), 0.0);
-
-        // print all times
-        std::ofstream fout;
-        fout.open(outfile, std::ios::app);
-        fout << tile_size << "," << t_total_time << "," << t_setup << ",";
-        for (size_t i = 0; i < reduce_times.size(); i++)
-            fout << reduce_times[i] << ",";
-        fout << t_apply_labels << "," << t_check << std::endl;
-        fout.close();
-    }  // end IF parent process
+    if (pid == 0) {
+        reduce(file, true, shared, true);
+        std::exit(0);
+    }
+    reduce_times = reduce(file, false, shared, true);
+    int status;
+    wait(&status);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::cerr << "Error: round 2 (pid " << pid << ") failed." << std::endl;
+        shared_memory_object::remove("BoostDualEx");
+        std::exit(1);
+    }
+    {
+        // the child is done with the global circuit execution: pre-process
+        // the equality check only now
+        EqCheckPool pool(party, peer_ip, port + 1000, eq_circuit(), 1, 1);
+        result = check_digests(pool, shared, t_apply_labels, t_check);
+    }
+    shared_memory_object::remove("BoostDualEx");
+#endif
+    std::cout << "Result: " << result << " (1: true, 0: false)." << std::endl;
+
+    double t_total_time =
+        t_setup + t_apply_labels + t_check +
+        std::accumulate(reduce_times.begin(), reduce_times.end(), 0.0);
+
+    // print all times
+    std::ofstream fout;
+    fout.open(outfile, std::ios::app);
+    fout << tile_size << "," << t_total_time << "," << t_setup << ",";
+    for (size_t i = 0; i < reduce_times.size(); i++)
+        fout << reduce_times[i] << ",";
+    fout << t_apply_labels << "," << t_check << std::endl;
+    fout.close();
 
     return 0;
 }
@@ -2,22 +2,62 @@
 
 #include <emp-tool/emp-tool.h>
 #include "include/single_execution.h"
+#include "include/dualex/ag2pc_wrapper.h"
 
 int main(int argc, char** argv) {
-       
-        if (argc < 4) {
-        	std::cerr << "Usage: " << argv[0] << " <party> <port> <ip_address> <filename>" << std::endl;
+
+        if (argc < 5) {
+        	std::cerr << "Usage: " << argv[0] << " <party> <port> <ip_address> <filename> [n_checks]" << std::endl;
         	return 1;
-    	} 	
-	
+    	}
+
 	int party, port;
 	emp::parse_party_and_port(argv, &party, &port);
 	const char* ip_address = argv[3];
     	const std::string filename = argv[4];
+	const int n_checks = (argc > 5) ? atoi(argv[5]) : 10;
 
 	emp::NetIO* io = new emp::NetIO(party==emp::ALICE ? nullptr:ip_address, port);
 //      io->set_nodelay();
         test<NetIO>(party, io, circuit_file_location+filename);
+
+	auto circuit = std::make_shared<BristolFormat>((circuit_file_location+filename).c_str());
+	bool *in = new bool[max(circuit->n1, circuit->n2)];
+	bool *out = new bool[circuit->n3];
+	memset(in, false, max(circuit->n1, circuit->n2));
+
+	// latency of a check before: pre-processing and online phase on the
+	// critical path
+	double t_before = 0;
+	for (int i = 0; i < n_checks; ++i) {
+		auto t1 = clock_start();
+		C2PC<NetIO> twopc(io, party, circuit.get());
+		io->flush();
+		twopc.function_independent();
+		io->flush();
+		twopc.function_dependent();
+		io->flush();
+		twopc.online(in, out, true);
+		t_before += time_from(t1);
+	}
+
+	// latency of a check after: instances pre-processed by the pool while it
+	// is idle, only the online phase is left
+	double t_after = 0;
+	{
+		EqCheckPool pool(party, io, circuit, n_checks);
+		for (int i = 0; i < n_checks; ++i) {
+			pool.wait_until_ready();
+			auto t1 = clock_start();
+			pool.run(in, out);
+			t_after += time_from(t1);
+		}
+	}
+	cout << "check latency before (no pool):\t" << party << "\t" << t_before / n_checks << endl;
+	cout << "check latency after (pool):\t" << party << "\t" << t_after / n_checks << endl;
+
+	delete[] in;
+	delete[] out;
         delete io;
         return 0;
 }
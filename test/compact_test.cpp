@@ -0,0 +1,94 @@
+// The L1 -> L2 reducer chain on list entries, against a plaintext reference:
+// two lists are sorted descending, de-duplicated and compacted, then the
+// first is reversed and the two are bitonic-merged (descending), de-duplicated
+// and compacted again. The result must be the distinct valid fingerprints,
+// descending, followed by none_entry().
+
+#include <emp-sh2pc/emp-sh2pc.h>
+#include <algorithm>
+#include <random>
+#include <set>
+#include "include/primitives.hpp"
+#include "include/reducer.hpp"
+#include "include/types.h"
+
+using namespace emp;
+using namespace std;
+
+// plaintext lists: a fingerprint, or -1 for an invalid entry
+vector<Integer> to_entries(const vector<int64_t>& values, int owner) {
+    vector<Integer> entries;
+    for (int64_t v : values) {
+        entries.emplace_back(make_entry(Integer(hashbits, v < 0 ? 12345 : v, owner),
+                                        Bit(v >= 0, owner)));
+    }
+    return entries;
+}
+
+void sort_dedupe_compact(Integer* list, size_t size, bool ascending) {
+    sort(list, size, (Bit*)nullptr, ascending);
+    vector<Integer> distance = compute_distance_mark_duplicates(list, size);
+    compact(distance, list, size);
+}
+
+// -1 for none_entry(), -2 for an invalid entry that is not none_entry()
+int64_t reveal_entry(const Integer& entry) {
+    Integer fingerprint = entry;
+    fingerprint.bits.pop_back();
+    const int64_t value = (int64_t)(uint32_t)fingerprint.reveal<int32_t>();
+    if (!valid_bit(entry).reveal<bool>()) return value == 0 ? -1 : -2;
+    return value;
+}
+
+int main(int argc, char** argv) {
+    int port, party;
+    if (argc < 3) {
+        std::cerr << "Usage: ./compact_test party port\n";
+        std::exit(-1);
+    }
+    parse_party_and_port(argv, &party, &port);
+    auto io =
+        std::make_unique<NetIO>(party == ALICE ? nullptr : "127.0.0.1", port);
+
+    setup_semi_honest(io.get(), party);
+
+    // both parties draw the same lists
+    std::mt19937 gen(42);
+    int failures = 0;
+    for (int round = 0; round < 20; ++round) {
+        vector<int64_t> a(2 + gen() % 30), b(2 + gen() % 30);
+        set<int64_t> distinct;
+        for (vector<int64_t>* list : {&a, &b}) {
+            for (int64_t& v : *list) {
+                v = (gen() % 3 == 0) ? -1 : (int64_t)(gen() % 20);
+                if (v >= 0) distinct.insert(v);
+            }
+        }
+        vector<int64_t> expected(distinct.rbegin(), distinct.rend());
+        expected.resize(a.size() + b.size(), -1);
+
+        vector<Integer> first = to_entries(a, ALICE);
+        vector<Integer> second = to_entries(b, BOB);
+        sort_dedupe_compact(&first[0], first.size(), false);
+        sort_dedupe_compact(&second[0], second.size(), false);
+        vector<Integer> merged(first.rbegin(), first.rend());
+        merged.insert(merged.end(), second.begin(), second.end());
+        bitonic_merge(&merged[0], (Bit*)nullptr, 0, merged.size(), false);
+        vector<Integer> distance =
+            compute_distance_mark_duplicates(&merged[0], merged.size());
+        compact(distance, &merged[0], merged.size());
+
+        for (size_t i = 0; i < merged.size(); ++i) {
+            const int64_t value = reveal_entry(merged[i]);
+            if (value != expected[i]) {
+                std::cerr << "round " << round << ": entry " << i << " is "
+                          << value << ", expected " << expected[i] << "\n";
+                failures++;
+                break;
+            }
+        }
+    }
+    std::cout << "compact " << (party == emp::ALICE ? "(gen)" : "(eva)")
+              << ": " << failures << " failed rounds\n";
+    return failures == 0 ? 0 : 1;
+}
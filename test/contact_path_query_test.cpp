@@ -5,6 +5,7 @@
 #include <include/secrets.hpp>
 #include <include/store_path_encounter.hpp>
 #include <include/contact_path_query.hpp>
+#include "path_query_fixture.hpp"
 #include <immintrin.h>
 #include <chrono>
 #include <iostream>
@@ -18,114 +19,25 @@ using namespace std;
 namespace pathquery {
 
 
-void fill_flow_encounters(struct encounter::encounter encounters[],
-                          const size_t device_count,
-                          const size_t encounter_count,
-                          const uint64_t nonce = 0,
-                          const encounter::Duration duration = 500
-                         ) {
-  std::cout << "time to generate some encounters\n" << std::flush;
-  encounter::Timestamp previous[device_count];
-  encounter::Timestamp times[32 * ((encounter_count + 31)/32)];
-  uint64_t hashme = nonce;
-  uint64_t hashme2 = nonce;
-  uint64_t hash[4];
-  for (size_t i = 0; i < device_count; ++i) {
-    previous[i] = 0;
-  }
-  std::cout << "fill those times with hashes...\n" << std::flush;
-  for (size_t i = 0; i < sizeof(times); i += 32) {
-    hashme += i;
-    SHA256((const unsigned char *) &hashme, sizeof(uint64_t), &(((unsigned char *) times)[i]) );
-  }
-  for (size_t i = 0; i < (32 * ((encounter_count + 31)/32)); ++i) {
-    times[i] &= 0x0fffffff;
-  }
-  std::cout << "trying to sort the pseudorandom times\n" << std::flush;
-  std::sort(times, &(times[(32 * ((encounter_count + 31)/32)) - 1]));
-  for (size_t i = 0; i < encounter_count; i += 2) {
-    hashme += i;
-    SHA256((const unsigned char *) &hashme, sizeof(uint64_t), ( unsigned char *) hash);
-    hashme2 = hash[0] % device_count;
-    SHA256((const unsigned char *) &hashme2, sizeof(uint64_t), ( unsigned char *) encounters[i].device);
-    encounters[i].previous = previous[hashme2];
-    encounters[i].time = times[i];
-    previous[hashme2] = encounters[i].time;
-    hashme2 = hash[1] % device_count;
-    SHA256((const unsigned char *) &hashme2, sizeof(uint64_t), ( unsigned char *) encounters[i].encountered);
-    SHA256((const unsigned char *) &(hash[2]), sizeof(uint64_t), ( unsigned char *) encounters[i].id);
-    encounters[i].confirmed = 1;
-    encounters[i].duration = duration;
-
-    memcpy(&(encounters[i+1].encountered), &(encounters[i].device), sizeof(encounter::DeviceID));
-    memcpy(&(encounters[i+1].device), &(encounters[i].encountered), sizeof(encounter::DeviceID));
-    memcpy(&(encounters[i+1].id), &(encounters[i].id), sizeof(encounter::EncounterID));
-    encounters[i+1].previous = previous[hashme2];
-    encounters[i+1].time = times[i+1];
-    previous[hashme2] = encounters[i+1].time;
-    encounters[i+1].confirmed = 1;
-    encounters[i+1].duration = duration;
-  }
-}
-
-
-bool test_end_to_end(ShuffleStore * shuffle_store,
-                     emp::NetIO *mrio,
-                     dualex::Revealer * revealer,         
-                     const ShuffleID shuffle_id,
-                     const size_t encounter_count,
-                     const size_t dummy_count,
-                     const __m256i dummy_nonce,
-                     const secrets::Side side,
-                     const size_t tile_size = 10
+int test_end_to_end(ShuffleStore * shuffle_store,
+                    emp::NetIO *mrio,
+                    dualex::Revealer * revealer,         
+                    const ShuffleID shuffle_id,
+                    const size_t encounter_count,
+                    const size_t dummy_count,
+                    const __m256i dummy_nonce,
+                    const secrets::Side side,
+                    const size_t tile_size = 10
                     ) {
-  uint64_t store_path_encounter_times[(encounter_count + tile_size - 1) / tile_size];
-  uint64_t send_shuffle_time;
-  uint64_t receive_shuffle_time;
-  struct storable_path_encounter * alice_shuffleable = (struct storable_path_encounter *)
-    aligned_alloc(32, (encounter_count + dummy_count) * sizeof(struct storable_path_encounter));
-  struct storable_path_encounter * bob_shuffleable = (struct storable_path_encounter *)
-    aligned_alloc(32, (encounter_count + dummy_count) * sizeof(struct storable_path_encounter));
   // create some sample encounters
   struct encounter::encounter original_encounters[encounter_count]; 
 
   fill_flow_encounters(original_encounters, 3, encounter_count);
 
-  emp::Integer original_encounter_integers[tile_size];
-  uint64_t start;
-  
-  // in batches of tile_size, make some encounters, put them in integers, and have Alice store them.
-  // move the sample encounters into Integers:
-  for (size_t i = 0; i < encounter_count; i += tile_size) {
-    encounter::fillIntegers(&(original_encounters[i]), original_encounter_integers, emp::PUBLIC, tile_size);
-    start = time_now_millis();
-    store_path_encounter(revealer,
-                         &(alice_shuffleable[i]),
-                         original_encounter_integers,
-                         side,
-                         secrets::LEFT,
-                         tile_size);
-    store_path_encounter_times[i / tile_size] = time_now_millis() - start;
-    std::cout << "stored path encounters " << i << " - " << (i + tile_size) <<
-      " in " << store_path_encounter_times[i / tile_size] << " milliseconds\n";
+  if (!store_and_shuffle(shuffle_store, mrio, revealer, shuffle_id, original_encounters, encounter_count, dummy_count,
+                         dummy_nonce, side, tile_size)) {
+    return 1;
   }
-  std::cout << "Alice has stored path encounters in a local array\n" <<std::flush;
-
-  // For this shuffle, Alice shuffles the integers, and sends them to bob:
-  if (side == secrets::LEFT) {
-    start = time_now_millis();
-    send_shuffle(mrio, shuffle_id, alice_shuffleable, encounter_count, dummy_count, dummy_nonce, side);
-    send_shuffle_time = time_now_millis() - start;
-    std::cout << "Alice has shuffled and transmitted encounters in " <<
-      send_shuffle_time << " milliseconds\n";
-  } else {
-    start = time_now_millis();
-    receive_shuffle(shuffle_store, mrio, shuffle_id, encounter_count + dummy_count);
-    receive_shuffle_time = time_now_millis() - start;
-    std::cout << "Bob has received an shuffled encounters in " << receive_shuffle_time << " milliseconds\n";
-  }
-  free(alice_shuffleable);
-  free(bob_shuffleable);
 
   encounter::encounter * start_tile = &(original_encounters[encounter_count - (2 * tile_size)]);
   encounter::encounter * end_tile = &(original_encounters[encounter_count - tile_size]);
@@ -185,6 +97,38 @@ bool test_end_to_end(ShuffleStore * shuffle_store,
   revealer->reveal<int32_t>(&output_count, 1, &revealed_output_count, secrets::BOTH, 32);
   std::cout << revealer->preamble() << "output_count: " << revealed_output_count << std::endl << std::flush;
 
+  // the same query with the sort join: exact, so never more than the Bloom filter count (which has false positives)
+  emp::Integer join_output_count;
+  contact<100, 3>( shuffle_store,
+             revealer,
+             &source_start_time_integer,
+             &sink_end_time_integer,
+             &max_duration_integer,
+             source_device_ids,
+             source_timestamps,
+             tile_size,
+             sink_device_ids,
+             sink_timestamps,
+             tile_size,
+             &shuffle_id,
+             &shuffle_start_time,
+             &dummy_nonce,
+             1,
+             &join_output_count,
+             side,
+             secrets::RIGHT,
+             30,
+             false,
+             WalkStrategy::SORT_JOIN
+            );
+  int32_t revealed_join_output_count;
+  revealer->reveal<int32_t>(&join_output_count, 1, &revealed_join_output_count, secrets::BOTH, 32);
+  std::cout << revealer->preamble() << "sort join output_count: " << revealed_join_output_count << std::endl << std::flush;
+  if (revealed_join_output_count > revealed_output_count) {
+    std::cerr << "sort join counted more contacts than the Bloom filter\n" << std::flush;
+    return 1;
+  }
+
   return 0;
 }
 
@@ -198,6 +142,7 @@ int runtests(int argc, char **argv) {
   parse_party_and_port(argv, &party, &port);
   const bool i_am_left = (party % 2) == 0;
   const secrets::Side side = i_am_left ? secrets::LEFT : secrets::RIGHT;
+  int result = 0;
 
   dualex::Revealer revealers[1] = {dualex::Revealer(side, 1024)};
   std::unique_ptr<secrets::Reusable_Secrets> reusable_secrets;
@@ -238,21 +183,22 @@ int runtests(int argc, char **argv) {
     ShuffleStore * shuffle_store = create_shuffle_store();
 
     io->sync();
-    std::cout << "test results: " << test_end_to_end(shuffle_store,
-                                                     io.get(),
-                                                     revealers,
-                                                     shuffle_id,
-                                                     1000, // encounter_count (MUST BE A MULTIPLE OF TILE SIZE)
-                                                     1000,//617119904 - 1000, //dummy_count (MUST BE A MULTIPLE OF TILE SIZE)
-                                                     dummy_nonce,
-                                                     side,
-                                                     10 // tile size
-                                                     ) << std::endl << std::flush;
+    result = test_end_to_end(shuffle_store,
+                             io.get(),
+                             revealers,
+                             shuffle_id,
+                             1000, // encounter_count (MUST BE A MULTIPLE OF TILE SIZE)
+                             1000,//617119904 - 1000, //dummy_count (MUST BE A MULTIPLE OF TILE SIZE)
+                             dummy_nonce,
+                             side,
+                             10 // tile size
+                             );
+    std::cout << "test results: " << result << std::endl << std::flush;
     std::cout << revealers[0].preamble() << "final eq_check_results: " << (revealers[0].get_eq_check_results() ? "TRUE" : "FALSE") << std::endl << std::flush;
     destroy_shuffle_store(shuffle_store);
     revealers[0].stop_eq_checker();
   }
-  return 0;
+  return result;
 }
 }
 
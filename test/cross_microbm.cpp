@@ -36,10 +36,10 @@ void run(int party, int port, int is_receiver, std::string peer_ip, std::string
   A.reserve(2*output_size);
   B.reserve(2*output_size);
   for (size_t i = 0; i < 2*output_size; i++) {
-    A.emplace_back(Integer(32, -1, emp::ALICE));
+    A.emplace_back(Integer(entrybits, -1, emp::ALICE));
   } 
   for (size_t i = 0; i < 2*output_size; i++) {
-    B.emplace_back(Integer(32, -1, emp::BOB));
+    B.emplace_back(Integer(entrybits, -1, emp::BOB));
   } 
   for (size_t i = 0; i < 2*output_size; i++) {
     lists.emplace_back(A[i] ^ B[i]);
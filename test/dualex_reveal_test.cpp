@@ -17,19 +17,70 @@ using namespace std;
 namespace dualex {
 
 
+// the Garbler and Non-Garbler side of the test
+void reveal_and_check(Revealer revealers[], emp::NetIO * io) {
+  std::cout << revealers[0].preamble() << " preparing to make integers" << std::endl << std::flush;
+  io->sync();
+  emp::Integer five = emp::Integer(8 * sizeof(uint64_t), (revealers[0].party() == emp::ALICE) ? 5 : 0, emp::ALICE);
+  emp::Integer nine = emp::Integer(8 * sizeof(uint64_t), (revealers[0].party() == emp::ALICE) ? 0 : 9, emp::BOB);
+  emp::Integer sum = five + nine;
+  io->sync();
+  uint64_t revealed;
+  bool reveal_output;
+  std::cout << revealers[0].preamble() << " preparing to call reveal" << std::endl << std::flush;
+  reveal_output = revealers[0].reveal<uint8_t>(&sum, sizeof(uint64_t), (uint8_t *) &revealed, secrets::RIGHT);
+  std::cout << revealers[0].preamble() << " reveal_success: " << (reveal_output ? "true" : "false") << " revealed: " << std::dec << revealed << std::endl << std::flush;
+
+
+  // do some work /before/ checking the eq results:
+  sum = sum + nine;
+  std::cout << revealers[0].preamble() << "eq check results: " << (revealers[0].get_eq_check_results() ? "true" : "false") << std::endl << std::flush;
+
+  std::cout << revealers[0].preamble() << " preparing to call second reveal." << std::endl << std::flush;
+  reveal_output = revealers[0].reveal<uint8_t>(&sum, sizeof(uint64_t), (uint8_t *) &revealed, secrets::LEFT);
+  std::cout << revealers[0].preamble() << "second reveal_success: " << (reveal_output ? "true" : "false") << " revealed: " << std::dec << revealed << std::endl << std::flush;
+  std::cout << revealers[0].preamble() << "second eq check results: " << (revealers[0].get_eq_check_results() ? "true" : "false") << std::endl << std::flush;
+
+  std::cout << revealers[1].preamble() << " preparing to use revealers[1]." << std::endl << std::flush;
+  reveal_output = revealers[1].reveal<uint8_t>(&sum, sizeof(uint64_t), (uint8_t *) &revealed, secrets::LEFT);
+  std::cout << revealers[1].preamble() << "revealers[1] reveal_success: " << (reveal_output ? "true" : "false") << " revealed: " << std::dec << revealed << std::endl << std::flush;
+  std::cout << revealers[1].preamble() << "revealers[1] eq check results: " << (revealers[1].get_eq_check_results() ? "true" : "false") << std::endl << std::flush;
+
+  // revealers[2] batches its reveals: two reveals, one eq check
+  std::cout << revealers[2].preamble() << " preparing to use batched revealers[2]." << std::endl << std::flush;
+  reveal_output = revealers[2].reveal<uint8_t>(&sum, sizeof(uint64_t), (uint8_t *) &revealed, secrets::RIGHT);
+  std::cout << revealers[2].preamble() << "revealers[2] first reveal_success: " << (reveal_output ? "true" : "false") << " revealed: " << std::dec << revealed << std::endl << std::flush;
+  reveal_output = revealers[2].reveal<uint8_t>(&sum, sizeof(uint64_t), (uint8_t *) &revealed, secrets::BOTH);
+  std::cout << revealers[2].preamble() << "revealers[2] second reveal_success: " << (reveal_output ? "true" : "false") << " revealed: " << std::dec << revealed << std::endl << std::flush;
+  std::cout << revealers[2].preamble() << "revealers[2] batched eq check results: " << (revealers[2].check_pending_reveals() ? "true" : "false") << std::endl << std::flush;
+
+  std::cout << revealers[0].preamble() << "stopping eq checker 0 ..." << std::endl << std::flush;
+  revealers[0].stop_eq_checker();
+  std::cout << revealers[0].preamble() << "done." << std::endl << std::flush;
+  std::cout << revealers[1].preamble() << "stopping eq checker 1 ..." << std::endl << std::flush;
+  revealers[1].stop_eq_checker();
+  std::cout << revealers[1].preamble() << "done." << std::endl << std::flush;
+  std::cout << revealers[2].preamble() << "stopping eq checker 2 ..." << std::endl << std::flush;
+  revealers[2].stop_eq_checker();
+  std::cout << revealers[2].preamble() << "done." << std::endl << std::flush;
+}
+
 int runtests(int argc, char **argv) {
 
 
   int test, port, party;
   if (argc < 3) {
-      std::cerr << "Usage: ./dualex_reveal_test party port\n";
+      std::cerr << "Usage: ./dualex_reveal_test party port [threads]\n";
       std::exit(-1);
   }
   parse_party_and_port(argv, &party, &port);
+  // run the roles as threads of one process instead of forked processes
+  const bool threads = (argc > 3) && (std::string(argv[3]) == "threads");
   const bool i_am_left = (party % 2) == 0;
   const secrets::Side side = i_am_left ? secrets::LEFT : secrets::RIGHT;
 
-  Revealer revealers[2] = {Revealer(side, 8 * sizeof(uint64_t)), Revealer(side, 8 * sizeof(uint64_t))};
+  Revealer revealers[3] = {Revealer(side, 8 * sizeof(uint64_t)), Revealer(side, 8 * sizeof(uint64_t)), Revealer(side, 8 * sizeof(uint64_t))};
+  revealers[2].set_reveals_per_eq_check(0);
   std::unique_ptr<secrets::Reusable_Secrets> reusable_secrets;
   std::unique_ptr<emp::AES_128_CTR_Calculator> aes;
   std::unique_ptr<emp::NetIO> io;
@@ -40,12 +91,32 @@ int runtests(int argc, char **argv) {
   const uint32_t right_bob_port = port;
   const uint32_t right_alice_port = port + 1;
   const uint32_t left_bob_port = port + 1;
-  const uint32_t left_eq_port[2] = {port + 2, port + 3};
-  const uint32_t right_eq_port[2] = {port + 2, port + 3};
-  const bool left_side_of_eq_checker_is_garbler[2] = {false, true};
+  const uint32_t left_eq_port[3] = {port + 2, port + 3, port + 4};
+  const uint32_t right_eq_port[3] = {port + 2, port + 3, port + 4};
+  const bool left_side_of_eq_checker_is_garbler[3] = {false, true, false};
+
+  if (threads) {
+    return run_and_setup(revealers,
+                         3,
+                         &left_ip,
+                         &right_ip,
+                         left_alice_port,
+                         left_bob_port,
+                         right_alice_port,
+                         right_bob_port,
+                         left_eq_port,
+                         right_eq_port,
+                         left_side_of_eq_checker_is_garbler,
+                         i_am_left,
+                         [](int me, Revealer role_revealers[], secrets::Reusable_Secrets *, emp::AES_128_CTR_Calculator *, emp::NetIO * role_io) {
+                           if (me < 2) {
+                             reveal_and_check(role_revealers, role_io);
+                           }
+                         }) ? 0 : 1;
+  }
 
   if(fork_and_setup(revealers,
-                   2,
+                   3,
                    &reusable_secrets,
                    &aes,
                    &io,
@@ -59,39 +130,7 @@ int runtests(int argc, char **argv) {
                    right_eq_port,
                    left_side_of_eq_checker_is_garbler,
                    i_am_left) < 2) {
-    std::cout << revealers[0].preamble() << " preparing to make integers" << std::endl << std::flush;
-    io->sync();
-    emp::Integer five = emp::Integer(8 * sizeof(uint64_t), (revealers[0].party() == emp::ALICE) ? 5 : 0, emp::ALICE);
-    emp::Integer nine = emp::Integer(8 * sizeof(uint64_t), (revealers[0].party() == emp::ALICE) ? 0 : 9, emp::BOB);
-    emp::Integer sum = five + nine;
-    io->sync();
-    uint64_t revealed;
-    bool reveal_output;
-    std::cout << revealers[0].preamble() << " preparing to call reveal" << std::endl << std::flush;
-    reveal_output = revealers[0].reveal<uint8_t>(&sum, sizeof(uint64_t), (uint8_t *) &revealed, secrets::RIGHT);
-    std::cout << revealers[0].preamble() << " reveal_success: " << (reveal_output ? "true" : "false") << " revealed: " << std::dec << revealed << std::endl << std::flush;
-
-
-    // do some work /before/ checking the eq results:
-    sum = sum + nine;
-    std::cout << revealers[0].preamble() << "eq check results: " << (revealers[0].get_eq_check_results() ? "true" : "false") << std::endl << std::flush;
-
-    std::cout << revealers[0].preamble() << " preparing to call second reveal." << std::endl << std::flush;
-    reveal_output = revealers[0].reveal<uint8_t>(&sum, sizeof(uint64_t), (uint8_t *) &revealed, secrets::LEFT);
-    std::cout << revealers[0].preamble() << "second reveal_success: " << (reveal_output ? "true" : "false") << " revealed: " << std::dec << revealed << std::endl << std::flush;
-    std::cout << revealers[0].preamble() << "second eq check results: " << (revealers[0].get_eq_check_results() ? "true" : "false") << std::endl << std::flush;
-
-    std::cout << revealers[1].preamble() << " preparing to use revealers[1]." << std::endl << std::flush;
-    reveal_output = revealers[1].reveal<uint8_t>(&sum, sizeof(uint64_t), (uint8_t *) &revealed, secrets::LEFT);
-    std::cout << revealers[1].preamble() << "revealers[1] reveal_success: " << (reveal_output ? "true" : "false") << " revealed: " << std::dec << revealed << std::endl << std::flush;
-    std::cout << revealers[1].preamble() << "revealers[1] eq check results: " << (revealers[1].get_eq_check_results() ? "true" : "false") << std::endl << std::flush;
-
-    std::cout << revealers[0].preamble() << "stopping eq checker 0 ..." << std::endl << std::flush;
-    revealers[0].stop_eq_checker();
-    std::cout << revealers[0].preamble() << "done." << std::endl << std::flush;
-    std::cout << revealers[1].preamble() << "stopping eq checker 1 ..." << std::endl << std::flush;
-    revealers[1].stop_eq_checker();
-    std::cout << revealers[1].preamble() << "done." << std::endl << std::flush;
+    reveal_and_check(revealers, io.get());
   }
   return 0;
 }
@@ -42,14 +42,14 @@ void generate_data_dmr(const size_t tile_size = 10000, const size_t output_size
 		confirmed.emplace_back(emp::Bit(1, emp::ALICE));
 	}
 	for (size_t i = 0; i < 2*tile_size; i++)
-		lists.emplace_back(emp::Integer(32, i, emp::ALICE));
+		lists.emplace_back(emp::Integer(entrybits, i, emp::ALICE));
 	for (size_t i = 0; i < tile_size; i++) {
 		did_1_b.emplace_back(emp::Integer(256, i, emp::BOB));
 		did_2_b.emplace_back(emp::Integer(256, tile_size - i, emp::BOB));
 		confirmed_b.emplace_back(emp::Bit(0, emp::BOB));
 	}
 	for (size_t i = 0; i < 2*tile_size; i++)
-		lists_b.emplace_back(emp::Integer(32, 0, emp::BOB));
+		lists_b.emplace_back(emp::Integer(entrybits, 0, emp::BOB));
 	for (size_t i = 0; i < tile_size; i++) {
 		did_1[i] = did_1[i] ^ did_1_b[i];
 		did_2[i] = did_2[i] ^ did_2_b[i];
@@ -86,22 +86,21 @@ void test_dmmr(const size_t tile_size = 10000) {
 	emp::Integer sick = did_1[0];
 
 	// start mapping
-	const emp::Integer none(32, -2147483648, emp::PUBLIC);
 	const emp::Bit one_bit(1, emp::PUBLIC);
 
 	// first map
 	std::vector<emp::Integer> tile;
 	for (size_t i = 0; i < tile_size; i++) {
 		tile.emplace_back(
-				emp::If((did_1[i] == sick) & (confirmed[i] == one_bit),
-					(did_2[i]).resize(32), none));
+				make_entry((did_2[i]).resize(hashbits),
+					(did_1[i] == sick) & (confirmed[i] == one_bit)));
 	}
 
 	// second map
 	for (size_t i = 0; i < tile_size; i++) {
 		tile.emplace_back(
-				emp::If((did_1[i] == sick) & (confirmed[i] == one_bit),
-					(did_2[i]).resize(32), none));
+				make_entry((did_2[i]).resize(hashbits),
+					(did_1[i] == sick) & (confirmed[i] == one_bit)));
 	}
 
 	// sort the tiles
@@ -137,14 +136,14 @@ void test_dmr(const size_t tile_size = 10000, const size_t output_size = 500) {
 		confirmed.emplace_back(emp::Bit(1, emp::ALICE));
 	}
 	for (size_t i = 0; i < 2*tile_size; i++)
-		lists.emplace_back(emp::Integer(32, i, emp::ALICE));
+		lists.emplace_back(emp::Integer(entrybits, i, emp::ALICE));
 	for (size_t i = 0; i < tile_size; i++) {
 		did_1_b.emplace_back(emp::Integer(256, i, emp::BOB));
 		did_2_b.emplace_back(emp::Integer(256, tile_size - i, emp::BOB));
 		confirmed_b.emplace_back(emp::Bit(0, emp::BOB));
 	}
 	for (size_t i = 0; i < 2*tile_size; i++)
-		lists_b.emplace_back(emp::Integer(32, 0, emp::BOB));
+		lists_b.emplace_back(emp::Integer(entrybits, 0, emp::BOB));
 	for (size_t i = 0; i < tile_size; i++) {
 		did_1[i] = did_1[i] ^ did_1_b[i];
 		did_2[i] = did_2[i] ^ did_2_b[i];
@@ -155,13 +154,12 @@ void test_dmr(const size_t tile_size = 10000, const size_t output_size = 500) {
 	emp::Integer sick = did_1[0];
 
 	// start mapping
-	const emp::Integer none(32, -2147483648, emp::PUBLIC);
 	const emp::Bit one_bit(1, emp::PUBLIC);
 
 	// first map appending to the lists
 	for (size_t i = 0; i < tile_size; i++) {
-		lists[output_size+i] = emp::If((did_1[i] == sick) & (confirmed[i] == one_bit),
-				(did_2[i]).resize(32), none);
+		lists[output_size+i] = make_entry((did_2[i]).resize(hashbits),
+				(did_1[i] == sick) & (confirmed[i] == one_bit));
 	}
 
 	// sort only the new tile
@@ -0,0 +1,317 @@
+#include <emp-sh2pc/emp-sh2pc.h>
+#include <emp-tool/circuits/sha3_256.h>
+#include <include/dualex_reveal.hpp>
+#include <include/encounter.hpp>
+#include <include/secrets.hpp>
+#include <include/store_path_encounter.hpp>
+#include <include/khop_path_query.hpp>
+#include "path_query_fixture.hpp"
+#include <immintrin.h>
+#include <chrono>
+#include <iostream>
+#include <sys/time.h>
+#include <ctime>
+#include <algorithm>
+#include <vector>
+
+using namespace emp;
+using namespace std;
+
+namespace pathquery {
+
+
+// the order of the emp::Integer ids made from DeviceIDs (little-endian, signed), in which khop() expands a frontier
+bool id_less(const encounter::DeviceID a, const encounter::DeviceID b) {
+  const size_t last = sizeof(encounter::DeviceID) - 1;
+  if (a[last] != b[last]) {
+    return (int8_t) a[last] < (int8_t) b[last];
+  }
+  for (size_t i = last; i-- > 0;) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i];
+    }
+  }
+  return false;
+}
+
+bool same_device(const encounter::DeviceID a, const encounter::DeviceID b) {
+  return memcmp(a, b, sizeof(encounter::DeviceID)) == 0;
+}
+
+// khop() on the plaintext encounters: a BFS from the sources (reached at start_time) over the population (the latest
+// record of each device). each frontier device walks back from its latest record through at most
+// encounters_per_device_per_shuffle records after shuffle_start_time, and an encounter reaches the encountered device
+// if it is confirmed, longer than minimum_duration and in (reach time of the walking device, end_time). the devices
+// first reached in a hop, in id order, are cut at frontier_bound for the next hop.
+// returns the number of devices first reached in each hop.
+std::vector<int32_t> plaintext_khop(const struct encounter::encounter encounters[],
+                                    const size_t encounter_count,
+                                    const std::vector<const encounter::encounter *> & sources,
+                                    const std::vector<const encounter::encounter *> & population,
+                                    const encounter::Timestamp start_time,
+                                    const encounter::Timestamp end_time,
+                                    const encounter::Duration minimum_duration,
+                                    const encounter::Timestamp shuffle_start_time,
+                                    const size_t hops,
+                                    const size_t frontier_bound,
+                                    const size_t encounters_per_device_per_shuffle) {
+  struct walker {
+    const uint8_t * id;
+    encounter::Timestamp latest;
+    encounter::Timestamp reach_time;
+  };
+  std::vector<bool> reached(population.size(), false);
+  std::vector<encounter::Timestamp> reach_time(population.size(), start_time);
+  const auto find_population = [&](const encounter::DeviceID id) {
+    for (size_t p = 0; p < population.size(); ++p) {
+      if (same_device(population[p]->device, id)) {
+        return p;
+      }
+    }
+    return population.size();
+  };
+  std::vector<walker> frontier;
+  for (const encounter::encounter * source : sources) {
+    frontier.push_back({source->device, source->time, start_time});
+    const size_t p = find_population(source->device);
+    if (p < population.size()) {
+      reached[p] = true;
+    }
+  }
+  std::vector<int32_t> hop_counts;
+  for (size_t hop = 0; hop < hops; ++hop) {
+    std::vector<bool> newly(population.size(), false);
+    for (const walker & w : frontier) {
+      encounter::Timestamp previous = w.latest;
+      for (size_t j = 0; j < encounters_per_device_per_shuffle && previous > shuffle_start_time; ++j) {
+        const encounter::encounter * e = std::find_if(encounters, encounters + encounter_count,
+                                                      [&](const encounter::encounter & x) {
+                                                        return x.time == previous && same_device(x.device, w.id);
+                                                      });
+        if (e == encounters + encounter_count) {
+          break;
+        }
+        const size_t p = find_population(e->encountered);
+        if (e->confirmed && e->duration > minimum_duration && w.reach_time < e->time && e->time < end_time &&
+            p < population.size() && !reached[p] && (!newly[p] || e->time < reach_time[p])) {
+          newly[p] = true;
+          reach_time[p] = e->time;
+        }
+        previous = e->previous;
+      }
+    }
+    std::vector<size_t> next;
+    for (size_t p = 0; p < population.size(); ++p) {
+      if (newly[p]) {
+        reached[p] = true;
+        next.push_back(p);
+      }
+    }
+    hop_counts.push_back((int32_t) next.size());
+    std::sort(next.begin(), next.end(), [&](size_t a, size_t b) {
+      return id_less(population[a]->device, population[b]->device);
+    });
+    next.resize(std::min(next.size(), frontier_bound));
+    frontier.clear();
+    for (size_t p : next) {
+      frontier.push_back({population[p]->device, population[p]->time, reach_time[p]});
+    }
+  }
+  return hop_counts;
+}
+
+
+int test_end_to_end(ShuffleStore * shuffle_store,
+                    emp::NetIO *mrio,
+                    dualex::Revealer * revealer,         
+                    const ShuffleID shuffle_id,
+                    const size_t encounter_count,
+                    const size_t dummy_count,
+                    const __m256i dummy_nonce,
+                    const secrets::Side side,
+                    const size_t tile_size = 10
+                    ) {
+  // create some sample encounters
+  struct encounter::encounter original_encounters[encounter_count]; 
+
+  const size_t device_count = 8;
+  fill_flow_encounters(original_encounters, device_count, encounter_count);
+
+  if (!store_and_shuffle(shuffle_store, mrio, revealer, shuffle_id, original_encounters, encounter_count, dummy_count,
+                         dummy_nonce, side, tile_size)) {
+    return 1;
+  }
+
+  // the population: every device with its most recent encounter. the sources: the devices of the earliest tile
+  const size_t hops = 3;
+  const size_t frontier_bound = 2;
+  emp::Integer output_count;
+  emp::Integer hop_counts[hops];
+  emp::Bit frontier_overflow;
+  std::vector<const encounter::encounter *> population;
+  std::vector<const encounter::encounter *> sources;
+  std::vector<emp::Integer> population_device_ids;
+  std::vector<emp::Integer> population_timestamps;
+  std::vector<emp::Integer> source_device_ids;
+  std::vector<emp::Integer> source_timestamps;
+  for (size_t i = encounter_count; i-- > 0;) {
+    const encounter::encounter * e = &(original_encounters[i]);
+    if (std::none_of(population.begin(), population.end(), [&](const encounter::encounter * s) { return same_device(s->device, e->device); })) {
+      population.push_back(e);
+      population_device_ids.emplace_back(8 * sizeof(encounter::DeviceID), e->device, emp::PUBLIC);
+      population_timestamps.emplace_back(8 * sizeof(encounter::Timestamp), e->time, emp::PUBLIC);
+    }
+  }
+  const encounter::encounter * start_tile = &(original_encounters[0]);
+  for (size_t i = 0; i < tile_size; ++i) {
+    if (std::none_of(start_tile, &(start_tile[i]), [&](const encounter::encounter & s) { return same_device(s.device, start_tile[i].device); })) {
+      sources.push_back(&(start_tile[i]));
+      source_device_ids.emplace_back(8 * sizeof(encounter::DeviceID), start_tile[i].device, emp::PUBLIC);
+      source_timestamps.emplace_back(8 * sizeof(encounter::Timestamp), start_tile[i].time, emp::PUBLIC);
+    }
+  }
+  std::cout << "population: " << population_device_ids.size() << " of " << device_count << " devices, sources: "
+            << source_device_ids.size() << std::endl << std::flush;
+
+  const emp::Integer start_time_integer = emp::Integer(8 * sizeof(encounter::Timestamp), original_encounters[0].time, emp::PUBLIC);
+  const emp::Integer end_time_integer = emp::Integer(8 * sizeof(encounter::Timestamp), original_encounters[encounter_count - 1].time, emp::PUBLIC);
+  const encounter::Duration minimum_duration = 3;
+  const emp::Integer max_duration_integer = emp::Integer(8 * sizeof(encounter::Duration), (int64_t) minimum_duration, emp::PUBLIC);
+  const encounter::Timestamp shuffle_start_time = 100;
+  const size_t encounters_per_device_per_shuffle = 30;
+  if (!khop(shuffle_store,
+            revealer,
+            &start_time_integer,
+            &end_time_integer,
+            &max_duration_integer,
+            source_device_ids.data(), // encodes list of most recent known encounters
+            source_timestamps.data(),
+            source_device_ids.size(),
+            population_device_ids.data(), // encodes list of most recent known encounters
+            population_timestamps.data(),
+            population_device_ids.size(),
+            &shuffle_id,
+            &shuffle_start_time,
+            &dummy_nonce,
+            1,
+            hops,
+            frontier_bound,
+            &output_count,
+            side,
+            secrets::RIGHT,
+            encounters_per_device_per_shuffle,
+            2, // batch size
+            hop_counts,
+            &frontier_overflow)) {
+    std::cerr << "khop failed\n" << std::flush;
+    return 1;
+  }
+
+  std::cout << "khop complete\n" << std::flush;
+  revealer->get_io()->sync();
+  int32_t revealed_output_count;
+  int32_t revealed_hop_counts[hops];
+  std::cout << revealer->preamble() << "eq_check_results immediately after khop(): " << (revealer->get_eq_check_results() ? "TRUE" : "FALSE") << std::endl << std::flush;
+  revealer->reveal<int32_t>(&output_count, 1, &revealed_output_count, secrets::BOTH, 32);
+  revealer->reveal<int32_t>(hop_counts, hops, revealed_hop_counts, secrets::BOTH, 32);
+  std::cout << revealer->preamble() << "output_count: " << revealed_output_count << std::endl << std::flush;
+  const std::vector<int32_t> expected_hop_counts = plaintext_khop(original_encounters, encounter_count, sources,
+                                                                  population, original_encounters[0].time,
+                                                                  original_encounters[encounter_count - 1].time, minimum_duration,
+                                                                  shuffle_start_time, hops, frontier_bound,
+                                                                  encounters_per_device_per_shuffle);
+  int32_t sum = 0;
+  int32_t expected_sum = 0;
+  bool matches = true;
+  for (size_t h = 0; h < hops; ++h) {
+    std::cout << revealer->preamble() << "hop " << h << " reached: " << revealed_hop_counts[h] << " (expected "
+              << expected_hop_counts[h] << ")" << std::endl << std::flush;
+    sum += revealed_hop_counts[h];
+    expected_sum += expected_hop_counts[h];
+    matches = matches && (revealed_hop_counts[h] == expected_hop_counts[h]);
+  }
+  // every population device is counted at most once, in the first hop that reaches it
+  if (sum != revealed_output_count || revealed_output_count > (int32_t) population_device_ids.size()) {
+    std::cerr << "khop counts are inconsistent\n" << std::flush;
+    return 1;
+  }
+  if (!matches || revealed_output_count != expected_sum) {
+    std::cerr << "khop reached " << revealed_output_count << " devices, the plaintext BFS " << expected_sum << "\n"
+              << std::flush;
+    return 1;
+  }
+
+  return 0;
+}
+
+
+int runtests(int argc, char **argv) {
+  int test, port, party;
+  if (argc < 3) {
+      std::cerr << "Usage: ./khop_path_query_test party port\n";
+      std::exit(-1);
+  }
+  parse_party_and_port(argv, &party, &port);
+  const bool i_am_left = (party % 2) == 0;
+  const secrets::Side side = i_am_left ? secrets::LEFT : secrets::RIGHT;
+  int result = 0;
+
+  dualex::Revealer revealers[1] = {dualex::Revealer(side, 1024)};
+  std::unique_ptr<secrets::Reusable_Secrets> reusable_secrets;
+  std::unique_ptr<emp::AES_128_CTR_Calculator> aes;
+  std::unique_ptr<emp::NetIO> io;
+
+  const std::string left_ip = "10.128.0.13"; // tdx01 is LEFT
+  const std::string right_ip = "10.128.0.5"; // snp01 is RIGHT
+  const uint32_t left_alice_port = port;
+  const uint32_t right_bob_port = port;
+  const uint32_t right_alice_port = port + 1;
+  const uint32_t left_bob_port = port + 1;
+  const uint32_t left_eq_port[1] = {port + 7};
+  const uint32_t right_eq_port[1] = {port + 7};
+  const bool left_side_of_eq_checker_is_garbler[1] = {true};
+
+  if(dualex::fork_and_setup(revealers,
+                            1,
+                            &reusable_secrets,
+                            &aes,
+                            &io,
+                            &left_ip,
+                            &right_ip,
+                            left_alice_port,
+                            left_bob_port,
+                            right_alice_port,
+                            right_bob_port,
+                            left_eq_port,
+                            right_eq_port,
+                            left_side_of_eq_checker_is_garbler,
+                            i_am_left) < 2) {
+    std::cout << revealers[0].preamble() << "revealer created" << std::endl << std::flush;
+    io->sync();
+    const EpochID epoch_id = 5;
+    const ShuffleID shuffle_id = 7;
+    const __m256i dummy_nonce = _mm256_set_epi64x((uint64_t) epoch_id,(uint64_t) shuffle_id,(uint64_t) epoch_id,(uint64_t) shuffle_id);
+
+    ShuffleStore * shuffle_store = create_shuffle_store();
+
+    io->sync();
+    result = test_end_to_end(shuffle_store,
+                             io.get(),
+                             revealers,
+                             shuffle_id,
+                             1000, // encounter_count (MUST BE A MULTIPLE OF TILE SIZE)
+                             1000,//617119904 - 1000, //dummy_count (MUST BE A MULTIPLE OF TILE SIZE)
+                             dummy_nonce,
+                             side,
+                             10 // tile size
+                             );
+    std::cout << "test results: " << result << std::endl << std::flush;
+    std::cout << revealers[0].preamble() << "final eq_check_results: " << (revealers[0].get_eq_check_results() ? "TRUE" : "FALSE") << std::endl << std::flush;
+    destroy_shuffle_store(shuffle_store);
+    revealers[0].stop_eq_checker();
+  }
+  return result;
+}
+}
+
+int main(int argc, char **argv) { return (pathquery::runtests(argc, argv)); }
@@ -147,7 +147,7 @@ void run(std::string file, bool malicious = true) {
 	if (id == 0 || id == 2 || id == 4 || id == 6) {
 		io->sync();
 		// receive one counter from the other process
-		receiver(semaphore_name1, shm_name1, &counter_to_sum, 1);
+		receiver(semaphore_name1, shm_name1, &counter_to_sum, 1, counter_bits);
 		// std::cout << "ID " << id << ": Got data from " << id + 1 << " on port " << reducer_port << std::endl;
 		io->sync();
 		count = count + counter_to_sum;
@@ -159,7 +159,7 @@ void run(std::string file, bool malicious = true) {
 		// std::cout << "ID " << id << ": Sending data in Round 1 on port "
 		// << reducer_port << std::endl;
 		// send its counter
-		sender(semaphore_name1, shm_name1, &count, 1);
+		sender(semaphore_name1, shm_name1, &count, 1, counter_bits);
 		// std::cout << "ID " << id << ": Data sent to " << id - 1 
 		// << " on port " << reducer_port  << std::endl;
 	}
@@ -172,7 +172,7 @@ void run(std::string file, bool malicious = true) {
 	if (id == 0 || id == 4) {
 		io->sync();
 		// std::cout << "ID: " << id << " About to receive data..." << std::endl;
-		receiver(semaphore_name2, shm_name2, &counter_to_sum, 1);
+		receiver(semaphore_name2, shm_name2, &counter_to_sum, 1, counter_bits);
 		// std::cout << "ID " << id << ": Got data from " << id + 2 <<
 		//	   " for second reduce stage"  << std::endl;
 		io->sync();
@@ -185,7 +185,7 @@ void run(std::string file, bool malicious = true) {
 		// // sends to the node with id - 1 (8 to 7, 6 to 5, 4 to 3, 2 to 1) 
 		// std::cout << "ID " << id << ": Sending data in Round 1 on
 		// port " << reducer_port << std::endl;
-		sender(semaphore_name2, shm_name2, &count, 1);
+		sender(semaphore_name2, shm_name2, &count, 1, counter_bits);
 		//std::cout << "ID " << id << ": Data sent to " << id - 1 
 		// << " on port " << reducer_port  << std::endl;
 		// std::cout << "ID " << id << ": Second reduce done." << std::endl;
@@ -204,7 +204,7 @@ void run(std::string file, bool malicious = true) {
 		io->sync();
 		// std::cout << "ID " << id << ": Receiving data last round to 1
 		// on port" << port_3 << std::endl;
-		receiver(semaphore_name3, shm_name3, &counter_to_sum, 1);
+		receiver(semaphore_name3, shm_name3, &counter_to_sum, 1, counter_bits);
 		// std::cout << "ID " << id << ": Got data in Round 3" <<
 		// std::endl;
 		io->sync();
@@ -214,7 +214,7 @@ void run(std::string file, bool malicious = true) {
 		io->sync();
 		// std::cout << "ID " << id << ": Establishing last connection
 		// on " << port_3 << std::endl;
-		sender(semaphore_name3, shm_name3, &count, 1);
+		sender(semaphore_name3, shm_name3, &count, 1, counter_bits);
 		// std::cout << "ID " << id << ": Data sent to 0 on port " <<
 		// port_3 << ", exiting..." << std::endl;
 	}
@@ -233,7 +233,7 @@ void run(std::string file, bool malicious = true) {
                 acceptor_.accept(socket_);
                 // std::cout << "ID " << id << ": Receiving data from another reducer 
                 // on port" << reducer_port << std::endl;
-                receive_list(socket_, &counter_to_sum, (size_t)1);  // load at the end
+                receive_list(socket_, &counter_to_sum, (size_t)1, counter_bits);  // load at the end
                 // std::cout << "ID " << id << ": Got data in Round 3" <<
                 // std::endl;
                 io->sync();
@@ -260,7 +260,7 @@ void run(std::string file, bool malicious = true) {
                 }
                 // std::cout << "ID " << id << ": Sending data last round to main reducer
                 // on port" << reducer_port << std::endl;
-                send_list_reverse(socket, &count, size_t(1));
+                send_list_reverse(socket, &count, size_t(1), counter_bits);
                 // std::cout << "ID " << id << ": Data sent to 0 on port " <<
                 // reducer_pott << ", exiting..." << std::endl;
 		}
@@ -285,7 +285,7 @@ void run(std::string file, bool malicious = true) {
                 acceptor_.accept(socket_);
                 // std::cout << "ID " << id << ": Receiving data from another reducer 
                 // on port" << reducer_port + 50 << std::endl;
-                receive_list(socket_, &counter_to_sum, (size_t)1);  // load at the end
+                receive_list(socket_, &counter_to_sum, (size_t)1, counter_bits);  // load at the end
                 // std::cout << "ID " << id << ": Got data in Round 3" <<
                 // std::endl;
                 io->sync();
@@ -312,7 +312,7 @@ void run(std::string file, bool malicious = true) {
                 }
                 // std::cout << "ID " << id << ": Sending data last round to main reducer
                 // on port" << reducer_port + 50 << std::endl;
-                send_list_reverse(socket, &count, (size_t)1);
+                send_list_reverse(socket, &count, (size_t)1, counter_bits);
                 // std::cout << "ID " << id << ": Data sent to 0 on port " <<
                 // reducer_port + 50 << ", exiting..." << std::endl;
 		}
@@ -0,0 +1,127 @@
+// The fixture shared by the path query tests: sample encounters, stored by Alice and shuffled to Bob.
+// Include it after the path query header, which defines time_now_millis().
+
+#pragma once
+#include <emp-sh2pc/emp-sh2pc.h>
+#include <emp-tool/circuits/sha3_256.h>
+#include <include/dualex_reveal.hpp>
+#include <include/encounter.hpp>
+#include <include/secrets.hpp>
+#include <include/store_path_encounter.hpp>
+#include <immintrin.h>
+#include <iostream>
+#include <algorithm>
+
+namespace pathquery {
+
+uint64_t time_now_millis();
+
+void fill_flow_encounters(struct encounter::encounter encounters[],
+                          const size_t device_count,
+                          const size_t encounter_count,
+                          const uint64_t nonce = 0,
+                          const encounter::Duration duration = 500
+                         ) {
+  std::cout << "time to generate some encounters\n" << std::flush;
+  encounter::Timestamp previous[device_count];
+  encounter::Timestamp times[32 * ((encounter_count + 31)/32)];
+  uint64_t hashme = nonce;
+  uint64_t hashme2 = nonce;
+  uint64_t hash[4];
+  for (size_t i = 0; i < device_count; ++i) {
+    previous[i] = 0;
+  }
+  std::cout << "fill those times with hashes...\n" << std::flush;
+  for (size_t i = 0; i < sizeof(times); i += 32) {
+    hashme += i;
+    SHA256((const unsigned char *) &hashme, sizeof(uint64_t), &(((unsigned char *) times)[i]) );
+  }
+  for (size_t i = 0; i < (32 * ((encounter_count + 31)/32)); ++i) {
+    times[i] &= 0x0fffffff;
+  }
+  std::cout << "trying to sort the pseudorandom times\n" << std::flush;
+  std::sort(times, &(times[(32 * ((encounter_count + 31)/32)) - 1]));
+  for (size_t i = 0; i < encounter_count; i += 2) {
+    hashme += i;
+    SHA256((const unsigned char *) &hashme, sizeof(uint64_t), ( unsigned char *) hash);
+    hashme2 = hash[0] % device_count;
+    SHA256((const unsigned char *) &hashme2, sizeof(uint64_t), ( unsigned char *) encounters[i].device);
+    encounters[i].previous = previous[hashme2];
+    encounters[i].time = times[i];
+    previous[hashme2] = encounters[i].time;
+    hashme2 = hash[1] % device_count;
+    SHA256((const unsigned char *) &hashme2, sizeof(uint64_t), ( unsigned char *) encounters[i].encountered);
+    SHA256((const unsigned char *) &(hash[2]), sizeof(uint64_t), ( unsigned char *) encounters[i].id);
+    encounters[i].confirmed = 1;
+    encounters[i].duration = duration;
+
+    memcpy(&(encounters[i+1].encountered), &(encounters[i].device), sizeof(encounter::DeviceID));
+    memcpy(&(encounters[i+1].device), &(encounters[i].encountered), sizeof(encounter::DeviceID));
+    memcpy(&(encounters[i+1].id), &(encounters[i].id), sizeof(encounter::EncounterID));
+    encounters[i+1].previous = previous[hashme2];
+    encounters[i+1].time = times[i+1];
+    previous[hashme2] = encounters[i+1].time;
+    encounters[i+1].confirmed = 1;
+    encounters[i+1].duration = duration;
+  }
+}
+
+
+// in batches of tile_size, put the sample encounters in integers and have Alice store them, then Alice shuffles them
+// (with dummy_count dummies) and sends them to Bob, who keeps them in shuffle_store.
+bool store_and_shuffle(ShuffleStore * shuffle_store,
+                       emp::NetIO *mrio,
+                       dualex::Revealer * revealer,
+                       const ShuffleID shuffle_id,
+                       const struct encounter::encounter original_encounters[],
+                       const size_t encounter_count,
+                       const size_t dummy_count,
+                       const __m256i dummy_nonce,
+                       const secrets::Side side,
+                       const size_t tile_size) {
+  uint64_t store_path_encounter_times[(encounter_count + tile_size - 1) / tile_size];
+  uint64_t send_shuffle_time;
+  uint64_t receive_shuffle_time;
+  bool shuffled;
+  struct storable_path_encounter * alice_shuffleable = (struct storable_path_encounter *)
+    aligned_alloc(32, (encounter_count + dummy_count) * sizeof(struct storable_path_encounter));
+  emp::Integer original_encounter_integers[tile_size];
+  uint64_t start;
+
+  // move the sample encounters into Integers:
+  for (size_t i = 0; i < encounter_count; i += tile_size) {
+    encounter::fillIntegers(&(original_encounters[i]), original_encounter_integers, emp::PUBLIC, tile_size);
+    start = time_now_millis();
+    store_path_encounter(revealer,
+                         &(alice_shuffleable[i]),
+                         original_encounter_integers,
+                         side,
+                         secrets::LEFT,
+                         tile_size);
+    store_path_encounter_times[i / tile_size] = time_now_millis() - start;
+    std::cout << "stored path encounters " << i << " - " << (i + tile_size) <<
+      " in " << store_path_encounter_times[i / tile_size] << " milliseconds\n";
+  }
+  std::cout << "Alice has stored path encounters in a local array\n" <<std::flush;
+  std::cout << revealer->preamble() << "get_eq_check_results: " << revealer->get_eq_check_results() << std::endl << std::flush;
+
+  // For this shuffle, Alice shuffles the integers, and sends them to bob:
+  if (side == secrets::LEFT) {
+    start = time_now_millis();
+    shuffled = send_shuffle(mrio, shuffle_id, alice_shuffleable, encounter_count, dummy_count, dummy_nonce, side);
+    send_shuffle_time = time_now_millis() - start;
+    std::cout << "Alice has shuffled and transmitted encounters in " <<
+      send_shuffle_time << " milliseconds\n";
+  } else {
+    start = time_now_millis();
+    shuffled = receive_shuffle(shuffle_store, mrio, shuffle_id, encounter_count + dummy_count);
+    receive_shuffle_time = time_now_millis() - start;
+    std::cout << "Bob has received an shuffled encounters in " << receive_shuffle_time << " milliseconds\n";
+  }
+  free(alice_shuffleable);
+  if (!shuffled) {
+    std::cerr << "failed to shuffle the sample encounters\n" << std::flush;
+  }
+  return shuffled;
+}
+}
@@ -0,0 +1,146 @@
+#include <emp-sh2pc/emp-sh2pc.h>
+#include <include/permutation.hpp>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+using namespace emp;
+using namespace std;
+
+// value stored at position i before permuting
+int64_t value(size_t i) { return 3 * (int64_t)i + 1; }
+
+void fill(Integer* data, size_t n, size_t width) {
+    for (size_t i = 0; i < n; ++i)
+        data[i] = Integer(width, value(i), (i % 2 == 0) ? ALICE : BOB);
+}
+
+// permutation known to ALICE only
+bool test_permute(size_t n, size_t width, int party) {
+    vector<size_t> perm(n);
+    for (size_t j = 0; j < n; ++j) perm[j] = (2 * n - 1 - j + n / 3) % n;
+    vector<Integer> data(n);
+    fill(data.data(), n, width);
+    permutation::permute(data.data(), n, ALICE,
+                         party == ALICE ? &perm : nullptr);
+    bool ok = true;
+    for (size_t j = 0; j < n; ++j) {
+        if (data[j].reveal<int64_t>(PUBLIC) != value(perm[j])) {
+            std::cerr << "permute n=" << n << ": data[" << j
+                      << "] was not what it was supposed to be\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// a bad permutation: the programmer gets false, and both parties still run
+// the same network (the reveals below would hang otherwise), leaving data
+// in place
+bool test_bad_permute(size_t n, int party) {
+    vector<size_t> perm(n + 1, 0);
+    vector<Integer> data(n);
+    fill(data.data(), n, 64);
+    const bool result = permutation::permute(data.data(), n, ALICE,
+                                             party == ALICE ? &perm : nullptr);
+    bool ok = (result == (party != ALICE));
+    if (!ok) std::cerr << "permute n=" << n << ": bad permutation accepted\n";
+    for (size_t j = 0; j < n; ++j) {
+        if (data[j].reveal<int64_t>(PUBLIC) != value(j)) {
+            std::cerr << "permute n=" << n
+                      << ": a bad permutation moved data[" << j << "]\n";
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// joint shuffle: the output must be a permutation of the input
+bool test_shuffle(size_t n, size_t width, int party) {
+    vector<Integer> data(n);
+    fill(data.data(), n, width);
+    if (!permutation::shuffle(data.data(), n, party)) {
+        std::cerr << "shuffle n=" << n << ": failed\n";
+        return false;
+    }
+    vector<int64_t> revealed(n);
+    for (size_t j = 0; j < n; ++j) revealed[j] = data[j].reveal<int64_t>(PUBLIC);
+    sort(revealed.begin(), revealed.end());
+    for (size_t j = 0; j < n; ++j) {
+        if (revealed[j] != value(j)) {
+            std::cerr << "shuffle n=" << n << ": output is not a permutation\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// both shuffle-based sorts, with duplicate keys and a wide payload
+// that must follow its key
+bool test_sorts(size_t n, int party) {
+    bool ok = true;
+    for (bool by_index : {true, false}) {
+        vector<Integer> key(n);
+        vector<Integer> payload(n);
+        for (size_t i = 0; i < n; ++i) {
+            key[i] = Integer(64, (int64_t)((i * 7919) % (n / 2 + 1)) - 5,
+                             (i % 2 == 0) ? ALICE : BOB);
+            payload[i] = Integer(300, (int64_t)((i * 7919) % (n / 2 + 1)), ALICE);
+        }
+        if (by_index)
+            permutation::sort_by_index(key.data(), n, payload.data(), party);
+        else
+            permutation::shuffle_sort(key.data(), n, payload.data(), party);
+        int64_t previous = INT64_MIN;
+        for (size_t i = 0; i < n; ++i) {
+            const int64_t k = key[i].reveal<int64_t>(PUBLIC);
+            const int64_t p = payload[i].reveal<int64_t>(PUBLIC);
+            if (k < previous || p != k + 5) {
+                std::cerr << (by_index ? "sort_by_index" : "shuffle_sort")
+                          << " n=" << n << ": entry " << i
+                          << " was not what it was supposed to be\n";
+                ok = false;
+            }
+            previous = k;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    int port, party;
+    if (argc < 3) {
+        std::cerr << "Usage: ./permutation_test party port\n";
+        std::exit(-1);
+    }
+    parse_party_and_port(argv, &party, &port);
+    auto io =
+        std::make_unique<NetIO>(party == ALICE ? nullptr : "127.0.0.1", port);
+
+    setup_semi_honest(io.get(), party);
+
+    bool ok = true;
+    for (size_t n : {1, 2, 3, 5, 8, 13, 100, 1000}) {
+        ok &= test_permute(n, 64, party);
+        ok &= test_permute(n, 257, party);
+        ok &= test_shuffle(n, 64, party);
+        ok &= test_bad_permute(n, party);
+    }
+    for (size_t n : {2, 7, 100, 1000}) ok &= test_sorts(n, party);
+
+    const size_t n = 10000;
+    vector<Integer> data(n);
+    fill(data.data(), n, 512);
+    auto const start = std::chrono::high_resolution_clock::now();
+    permutation::shuffle(data.data(), n, party);
+    auto const finish = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> const elapsed = finish - start;
+    std::cout << "shuffle " << n << " x 512 bits "
+              << (party == emp::ALICE ? "(gen)" : "(eva)") << ": "
+              << elapsed.count() << '\n';
+
+    std::cout << (ok ? "permutation_test passed" : "permutation_test FAILED")
+              << std::endl;
+    finalize_semi_honest();
+    return ok ? 0 : 1;
+}
@@ -19,6 +19,38 @@ int runtests(int argc, char **argv) {
 
     setup_semi_honest(io.get(), party);
     secrets::Reusable_Secrets shared_secrets = secrets::Reusable_Secrets(false);
+
+    // each PRF in circuit against its out-of-circuit counterpart
+    uint8_t left_xor_right[SECRET_SIZE];
+    for (size_t i = 0; i < SECRET_SIZE; ++i) {
+        left_xor_right[i] = LEFT_SECRET[i] ^ RIGHT_SECRET[i];
+    }
+    uint8_t input[40];
+    for (size_t i = 0; i < sizeof(input); ++i) {
+        input[i] = (uint8_t) (7 * i + 1);
+    }
+    const Integer input_integer(8 * sizeof(input), input, PUBLIC);
+    const Integer key_integer(8 * SECRET_SIZE, input, PUBLIC);
+    for (const PRF f : {PRF::SHA3_256, PRF::AES_128}) {
+        shared_secrets.set_prf(f);
+        Integer output;
+        uint8_t revealed[32];
+        uint8_t expected[32];
+        shared_secrets.mac(&output, &input_integer);
+        output.reveal(revealed, PUBLIC);
+        secrets::prf(f, expected, left_xor_right, input, sizeof(input));
+        if (memcmp(revealed, expected, sizeof(expected)) != 0) {
+            std::cerr << "mac does not match its out-of-circuit PRF\n";
+            return 1;
+        }
+        shared_secrets.rekey(&output, LEFT, &key_integer);
+        output.reveal(revealed, PUBLIC);
+        secrets::rekey(f, expected, LEFT_SECRET, input);
+        if (memcmp(revealed, expected, sizeof(expected)) != 0) {
+            std::cerr << "rekey does not match its out-of-circuit PRF\n";
+            return 2;
+        }
+    }
     return 0;
 }
 }  // namespace secrets
@@ -4,6 +4,7 @@
 #include <bloomfilter.h>
 #include <emp-sh2pc/emp-sh2pc.h>
 #include <cassert>
+#include <include/permutation.hpp>
 
 #include <immintrin.h>
 
@@ -63,5 +64,29 @@ int main(int argc, char** argv) {
             std::cout << "\n";
         }
     }
+
+    // same input, sorted by shuffle-then-sort
+    for (uint64_t j = 0; j < size; ++j) {
+        m_ptr[3] = (716192737 + j) % size;
+        res[j] =
+            Integer(&m, ((emp::ALICE % 2) == (j % 2)) ? emp::ALICE : emp::BOB);
+    }
+    auto const shuffle_start = std::chrono::high_resolution_clock::now();
+    permutation::shuffle_sort(res, size, nullptr, party, true);
+    auto const shuffle_finish = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> const shuffle_elapsed =
+        shuffle_finish - shuffle_start;
+    std::cout << "shuffle sort " << (party == emp::ALICE ? "(gen)" : "(eva)")
+              << ": " << shuffle_elapsed.count() << '\n';
+
+    for (uint64_t i = 0; i < size; ++i) {
+        res[i].reveal(&m, emp::PUBLIC);
+        if (m_ptr[3] != i) {
+            std::cerr << "shuffle sort: res[" << i
+                      << "] was not what it was supposed to be\n";
+            printxM256(m);
+            std::cout << "\n";
+        }
+    }
     return 0;
 }
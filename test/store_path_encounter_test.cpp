@@ -60,6 +60,39 @@ bool check_decrypted(const std::string message,
   return true;
 }
 
+// the batched encrypt_storable_path_encounters against encrypt_storable_path_encounter on each record,
+// for sizes that fill the groups of 4 exactly or leave a padded tail, and with enough groups to split across threads
+int test_batched_encrypt() {
+  const size_t sizes[] = {1, 3, 4, 5, 7, 9, 1027};
+  const secrets::Side sides[] = {secrets::LEFT, secrets::RIGHT};
+  for (const secrets::Side side : sides) {
+    const __m256i secret = ((__m256i *) ((side == secrets::LEFT) ? secrets::LEFT_SECRET : secrets::RIGHT_SECRET))[0];
+    for (const size_t size : sizes) {
+      std::vector<struct storable_path_encounter> expected(size);
+      for (size_t r = 0; r < size; ++r) {
+        for (size_t b = 0; b < sizeof(struct storable_path_encounter); ++b) {
+          ((uint8_t *) &expected[r])[b] = (uint8_t) (b * 131 + r * 17 + 1);
+        }
+        // the low counter words at their largest, so that a carry into the upper half would show
+        ((uint64_t *) &(expected[r].key.vec))[0] = ~0ULL - (r % 16);
+      }
+      std::vector<struct storable_path_encounter> batched(expected);
+      for (size_t r = 0; r < size; ++r) {
+        encrypt_storable_path_encounter(&expected[r], secret);
+      }
+      encrypt_storable_path_encounters(batched.data(), size, side, secrets::PRF::SHA3_256, 4);
+      if (!check_byte_equality<struct storable_path_encounter>("batched encrypt does not match the per-record encrypt\n",
+                                                               batched.data(), expected.data(), size)) {
+        std::cerr << "FAILED: test_batched_encrypt with size " << size
+                  << " on the " << ((side == secrets::LEFT) ? "left" : "right") << " side" << std::endl << std::flush;
+        return 1;
+      }
+    }
+  }
+  std::cout << "test_batched_encrypt passed" << std::endl << std::flush;
+  return 0;
+}
+
 int test_end_to_end(ShuffleStore * shuffle_store,
                     emp::NetIO *mrio,
                     dualex::Revealer * revealer,
@@ -197,7 +230,7 @@ int test_end_to_end(ShuffleStore * shuffle_store,
     std::cout << "Alice has shuffled and transmitted encounters\n" <<std::flush;
   } else {
     receive_shuffle(shuffle_store, mrio, shuffle_id, encounter_count + dummy_count);
-    struct storable_path_encounter * bob_shuffleable = (*shuffle_store)[shuffle_id].second;
+    struct storable_path_encounter * bob_shuffleable = shuffle_store_get(shuffle_store, shuffle_id);
     for (size_t i = 0; i < encounter_count + dummy_count; ++i) {
       for (size_t j = 0; j < encounter_count; ++j) {
         if (  ((uint64_t *) bob_after_shuffle[j].key.bytes)[0] == ((uint64_t *) bob_shuffleable[i].key.bytes)[0]
@@ -283,10 +316,52 @@ int test_end_to_end(ShuffleStore * shuffle_store,
     }
   }
   std::cout << "all encounters fetched and correct.\n" << std::flush;
+
+  // and all of them again, in one batch
+  emp::Integer device_ids[encounter_count];
+  emp::Integer times[encounter_count];
+  emp::Integer batch_encountered[encounter_count];
+  emp::Integer batch_previous[encounter_count];
+  emp::Integer batch_duration[encounter_count];
+  emp::Integer batch_confirmed[encounter_count];
+  for (size_t i = 0; i < encounter_count; ++i) {
+    device_ids[i] = emp::Integer(8 * sizeof(encounter::DeviceID), original_encounters[i].device);
+    times[i] = emp::Integer(8 * sizeof(encounter::Timestamp), &(original_encounters[i].time));
+  }
+  if (!fetch_and_decrypt_encounters(shuffle_store,
+                                    revealer,
+                                    shuffle_id,
+                                    device_ids,
+                                    times,
+                                    encounter_count,
+                                    batch_encountered,
+                                    batch_previous,
+                                    batch_duration,
+                                    batch_confirmed,
+                                    side,
+                                    secrets::RIGHT)) {
+    std::cerr << "something went wrong in fetch_and_decrypt_encounters\n" <<std::flush;
+    return -6;
+  }
+  for (size_t i = 0; i < encounter_count; ++i) {
+    batch_encountered[i].reveal(encountered_reveal, emp::PUBLIC);
+    batch_previous[i].reveal(&previous_reveal, emp::PUBLIC);
+    batch_duration[i].reveal(&duration_reveal, emp::PUBLIC);
+    batch_confirmed[i].reveal(&confirmed_reveal, emp::PUBLIC);
+    if (memcmp(original_encounters[i].encountered, encountered_reveal, sizeof(encounter::DeviceID)) != 0 ||
+        original_encounters[i].previous != previous_reveal ||
+        original_encounters[i].duration != duration_reveal ||
+        original_encounters[i].confirmed != confirmed_reveal) {
+      std::cerr << "batch fetched encounter " << i << " does not match the original\n" <<std::flush;
+      return -7;
+    }
+  }
+  std::cout << "all encounters batch fetched and correct.\n" << std::flush;
   return 0;
 }
 
-bool benchmark(ShuffleStore * shuffle_store,
+// with a file-backed shuffle_store, it is reopened after the shuffle (as after a restart), and fetched from.
+bool benchmark(ShuffleStore *& shuffle_store,
                emp::NetIO *mrio,
                dualex::Revealer * revealer,
                const ShuffleID shuffle_id,
@@ -353,6 +428,16 @@ bool benchmark(ShuffleStore * shuffle_store,
     std::cout << revealer->preamble() << "receive_shuffle end" << std::endl << std::flush;
     receive_shuffle_time = time_now_millis() - start;
     std::cout << "Bob has received an shuffled encounters in " << receive_shuffle_time << " milliseconds\n";
+    if (!shuffle_store->directory.empty()) {
+      const std::string directory = shuffle_store->directory;
+      start = time_now_millis();
+      destroy_shuffle_store(shuffle_store);
+      shuffle_store = open_shuffle_store(directory);
+      std::cout << "Bob has reopened the shuffle store in " << (time_now_millis() - start) << " milliseconds\n";
+      if (shuffle_store_get(shuffle_store, shuffle_id) == nullptr) {
+        std::cerr << "shuffle " << shuffle_id << " missing after reopening the shuffle store\n" << std::flush;
+      }
+    }
   }
   shuffle_time = time_now_millis() - shuffle_time;
   total_store_time =time_now_millis() -  total_store_time;
@@ -387,6 +472,36 @@ bool benchmark(ShuffleStore * shuffle_store,
       std::cout << "fetched encounter " << i+j << " in " << fetch_times[i + j] << " milliseconds\n";
     }
   }
+  // the same fetches, tile_size at a time with fetch_and_decrypt_encounters
+  emp::Integer device_ids[tile_size];
+  emp::Integer times[tile_size];
+  emp::Integer batch_encountered[tile_size];
+  emp::Integer batch_previous[tile_size];
+  emp::Integer batch_duration[tile_size];
+  emp::Integer batch_confirmed[tile_size];
+  uint64_t batch_fetch_time = time_now_millis();
+  for (size_t i = 0; (i < encounter_count) && (i < fetch_count); i += tile_size) {
+    encounter::fillEncounters(original_encounters, tile_size, i);
+    const size_t batch = std::min(tile_size, fetch_count - i);
+    for (size_t j = 0; j < batch; ++j) {
+      device_ids[j] = emp::Integer(8 * sizeof(encounter::DeviceID), original_encounters[j].device);
+      times[j] = emp::Integer(8 * sizeof(encounter::Timestamp), &(original_encounters[j].time));
+    }
+    fetch_and_decrypt_encounters(shuffle_store,
+                                 revealer,
+                                 shuffle_id,
+                                 device_ids,
+                                 times,
+                                 batch,
+                                 batch_encountered,
+                                 batch_previous,
+                                 batch_duration,
+                                 batch_confirmed,
+                                 side,
+                                 secrets::RIGHT);
+  }
+  batch_fetch_time = time_now_millis() - batch_fetch_time;
+  std::cout << "batch fetched " << std::min(encounter_count, fetch_count) << " encounters in " << batch_fetch_time << " milliseconds\n";
   std::cout << "tile_store_times[" << ((encounter_count + tile_size - 1) / tile_size) << "] = ";
   for (size_t i = 0; i < encounter_count; i += tile_size) {
     std::cout << tile_store_times[i / tile_size] << ", ";
@@ -400,6 +515,7 @@ bool benchmark(ShuffleStore * shuffle_store,
 
   std::cout << "shuffle_time = " << shuffle_time << std::endl;
   std::cout << "total_store_time = " << total_store_time << std::endl;
+  std::cout << "batch_fetch_time = " << batch_fetch_time << std::endl;
 
 
   return 0;
@@ -409,13 +525,18 @@ bool benchmark(ShuffleStore * shuffle_store,
 int runtests(int argc, char **argv) {
   int test, port, party;
   if (argc < 3) {
-      std::cerr << "Usage: ./store_path_encounter_test party port\n";
+      std::cerr << "Usage: ./store_path_encounter_test party port [shuffle store directory]\n";
       std::exit(-1);
   }
   parse_party_and_port(argv, &party, &port);
   const bool i_am_left = (party % 2) == 0;
   const secrets::Side side = i_am_left ? secrets::LEFT : secrets::RIGHT;
 
+  test = test_batched_encrypt();
+  if (test != 0) {
+    return test;
+  }
+
   dualex::Revealer revealers[1] = {dualex::Revealer(side, 1024)};
   std::unique_ptr<secrets::Reusable_Secrets> reusable_secrets;
   std::unique_ptr<emp::AES_128_CTR_Calculator> aes;
@@ -452,7 +573,7 @@ int runtests(int argc, char **argv) {
     const ShuffleID shuffle_id = 7;
     const __m256i dummy_nonce = _mm256_set_epi64x((uint64_t) epoch_id,(uint64_t) shuffle_id,(uint64_t) epoch_id,(uint64_t) shuffle_id);
 
-    ShuffleStore * shuffle_store = create_shuffle_store();
+    ShuffleStore * shuffle_store = (argc > 3) ? open_shuffle_store(argv[3]) : create_shuffle_store();
 
     //test = test_end_to_end(shuffle_store, io.get(), revealers, shuffle_id, 10, 5, dummy_nonce, side);
     //if (test != 0) {
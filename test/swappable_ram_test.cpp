@@ -10,6 +10,8 @@
 #include <ctime>
 #include <algorithm>
 #include<unistd.h>
+#include <sys/wait.h>
+#include <thread>
 
 using namespace emp;
 using namespace std;
@@ -34,8 +36,89 @@ int runtests(int argc, char **argv) {
   std::cout << me << " has " << swappy.get<uint64_t>()[0] << " after 3 swaps\n" << std::flush;
   swappy.swap();
   std::cout << me << " has " << swappy.get<uint64_t>()[0] << " after 4 swaps\n" << std::flush;
+  // (parent is the process fork() returned 0 in)
+  if (parent) {
+    std::exit(0);
+  }
+  wait(nullptr);
   return 0;
 }
+
+// 3 processes, each writes its party, and after each rotation has the next party's patch
+int three_party_test() {
+  SwappableRam ring(sizeof(uint64_t), 3);
+  const int party = fork_n_processes(3);
+  if (party < 0 || !ring.choose_party(party)) {
+    return 1;
+  }
+  bool ok = true;
+  ring.get<uint64_t>()[0] = party;
+  for (int rotation = 1; rotation <= 3; ++rotation) {
+    ring.swap();
+    const uint64_t expected = (party + rotation) % 3;
+    std::cout << "party " << party << " has " << ring.get<uint64_t>()[0] << " after " << rotation
+              << " rotations (expected " << expected << ")\n" << std::flush;
+    ok = ok && (ring.get<uint64_t>()[0] == expected);
+  }
+  if (party != 0) {
+    std::exit(ok ? 0 : 1);
+  }
+  int status;
+  while (wait(&status) > 0) {
+    ok = ok && WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+  }
+  std::cout << "three party rotation " << (ok ? "passed" : "FAILED") << std::endl << std::flush;
+  return ok ? 0 : 1;
+}
+
+// n swaps in lockstep, each side writing i and reading the other's i
+// returns the mean time per swap (ns), or negative if a value went missing
+double handoff(SwappableRam & ram, const bool side, const size_t n) {
+  if (!ram.choose_side(side)) {
+    return -1;
+  }
+  size_t errors = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < n; ++i) {
+    ram.get<uint64_t>()[0] = 2 * i + side;
+    ram.swap();
+    errors += (ram.get<uint64_t>()[0] != 2 * i + !side);
+  }
+  const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  return (errors == 0) ? ns / n : -1;
+}
+
+// microbenchmark: hand-off latency of a swap, between processes and between threads
+int latency_benchmark(const size_t n) {
+  SwappableRam across_processes(sizeof(uint64_t));
+  const pid_t child = fork();
+  const double process_ns = handoff(across_processes, child == 0, n);
+  if (child == 0) {
+    std::exit(process_ns < 0 ? 1 : 0);
+  }
+  int status;
+  waitpid(child, &status, 0);
+
+  SwappableRam across_threads(sizeof(uint64_t));
+  SwappableRam other_thread(across_threads);
+  double thread_ns = 0;
+  std::thread t([&] { thread_ns = handoff(other_thread, false, n); });
+  const double my_thread_ns = handoff(across_threads, true, n);
+  t.join();
+
+  std::cout << "hand-off latency (processes):\t" << process_ns << " ns per swap" << std::endl;
+  std::cout << "hand-off latency (threads):\t" << my_thread_ns << " ns per swap" << std::endl << std::flush;
+  const bool ok = (process_ns >= 0) && WIFEXITED(status) && (WEXITSTATUS(status) == 0) && (thread_ns >= 0) && (my_thread_ns >= 0);
+  return ok ? 0 : 1;
 }
 
-int main(int argc, char **argv) { return (dualex::runtests(argc, argv)); }
+}
+
+// optional argument: number of swaps for the latency benchmark
+int main(int argc, char **argv) {
+  const size_t n = (argc > 1) ? atoi(argv[1]) : 100000;
+  int result = dualex::runtests(argc, argv);
+  result |= dualex::three_party_test();
+  result |= dualex::latency_benchmark(n);
+  return result;
+}
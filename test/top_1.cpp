@@ -54,6 +54,24 @@ void compact(std::vector<emp::Integer>& distance, emp::Integer* data, emp::Integ
 	}
 }
 
+// compute distance for the compact primitive (pre-processing step), for a
+// list where the dropped categories are set to null
+std::vector<emp::Integer> compute_distance_null(const emp::Integer* list,
+		size_t size, const emp::Integer& null) {
+	size_t n_bits = floor(log2(size - 1)) + 1;
+	const emp::Integer zero = emp::Integer(n_bits, 0, emp::PUBLIC);
+	const emp::Integer one = emp::Integer(n_bits, 1, emp::PUBLIC);
+	emp::Integer count_none = zero;
+	emp::Bit condition;
+	std::vector<emp::Integer> distance;
+	for (size_t i = 0; i < size; i++) {
+		condition = (list[i] == null);
+		distance.emplace_back(emp::If(condition, zero, count_none));
+		count_none = count_none + emp::If(condition, one, zero);
+	}
+	return distance;
+}
+
 // tile sizes to test
 const size_t n_parties = 1000000; // 10^6
 const size_t n_categories = 32768; // 2^15
@@ -122,7 +140,6 @@ int main(int argc, char* argv[]) {
 		emp::Integer one = emp::Integer(n_bits, 1, emp::PUBLIC);	
 		emp::Integer zero = emp::Integer(n_bits, 0, emp::PUBLIC);	
 		const emp::Integer null(n_bits, -2147483648, emp::PUBLIC);
-		emp::Bit zero_bit = emp::Bit(0, emp::PUBLIC);	
 		double t_setup = duration(time_now() - start);
 
 		std::cout << "Inputs: " << input_size << std::endl
@@ -158,8 +175,7 @@ int main(int argc, char* argv[]) {
 
 		// process the inputs
 		start = time_now();
-		emp::Bit condition = zero_bit;
-		emp::Integer count = one;
+		auto add = [](const emp::Integer& a, const emp::Integer& b) { return a + b; };
 		// for each chunk
 		for (size_t i = 0; i < input_size/chunk_size; i++) {
 			size_t start_idx = i * n_categories;
@@ -170,17 +186,15 @@ int main(int argc, char* argv[]) {
 			//	std::cout << "After Sort Element " << i << " (total " << chunk_size << ") "
 			//		<< j << ": " << list[j].reveal<int>() << std::endl;
 			// }
-			count = one;
-			// scan the chunk and update the frequencies
-			for (size_t j = start_idx; j < start_idx + chunk_size - 1; j++) {
-				condition = (list[j] == list[j + 1]);
-				frequency[j] = emp::If(condition == zero_bit, count, zero);
-				list[j] = emp::If(condition == zero_bit, list[j], null);
-				count = emp::If(condition == zero_bit, one, count + one);
-			}
-			frequency[start_idx + chunk_size - 1] = emp::If(condition == zero_bit, one, count);
+			// scan the chunk and update the frequencies (log-depth segmented
+			// count, the total is kept on the last element of each category)
+			std::vector<emp::Bit> heads = segment_heads(&list[start_idx], chunk_size);
+			for (size_t j = start_idx; j < start_idx + chunk_size; j++)
+				frequency[j] = one;
+			segmented_scan(heads, &frequency[start_idx], chunk_size, add);
+			keep_segment_tails(heads, &list[start_idx], &frequency[start_idx], chunk_size, null, zero);
 			// compact
-			std::vector<emp::Integer> distance = compute_distance_mark_duplicates(&list[start_idx], chunk_size);
+			std::vector<emp::Integer> distance = compute_distance_null(&list[start_idx], chunk_size, null);
 			compact(distance, &list[start_idx], &frequency[start_idx], chunk_size);
 			list.erase(list.begin() + start_idx + n_categories, list.begin() + start_idx + chunk_size);
 			frequency.erase(frequency.begin() + start_idx + n_categories, frequency.begin() + start_idx + chunk_size);
@@ -218,19 +232,12 @@ int main(int argc, char* argv[]) {
 			std::reverse(frequency.begin(), frequency.begin() + n_categories);
 			// merge the first two chunks
 			emp::bitonic_merge(&list[0], &frequency[0], 0, merge_size, false);
-			// scan the chunk and update the frequencies
-			count = zero;
-			emp::Integer tmp_f = zero;
-			for (size_t j = 0; j < merge_size - 1; j++) {
-				condition = (list[j] == list[j + 1]);
-				emp::Integer tmp_f = frequency[j];
-				frequency[j] = emp::If(condition == zero_bit, frequency[j] + count, zero);
-				list[j] = emp::If(condition == zero_bit, list[j], null);
-				count = emp::If(condition == zero_bit, zero, tmp_f + count);
-			}
-			frequency[merge_size - 1] = emp::If(condition == zero_bit, frequency[merge_size - 1], frequency[merge_size - 1] + count);
-			// compact and remove duplicates
-			std::vector<emp::Integer> distance = compute_distance_mark_duplicates(&list[0], merge_size);
+			// scan the chunk and update the frequencies (log-depth segmented sum)
+			std::vector<emp::Bit> heads = segment_heads(&list[0], merge_size);
+			segmented_scan(heads, &frequency[0], merge_size, add);
+			keep_segment_tails(heads, &list[0], &frequency[0], merge_size, null, zero);
+			// compact
+			std::vector<emp::Integer> distance = compute_distance_null(&list[0], merge_size, null);
 			compact(distance, &list[0], &frequency[0], merge_size);
 			list.erase(list.begin() + n_categories, list.begin() + merge_size);
 			frequency.erase(frequency.begin() + n_categories, frequency.begin() + merge_size);